@@ -0,0 +1,97 @@
+// Compares the cost per record of the anonymization strategies on a
+// synthetic stream where most requests come from a few heavy-hitter clients.
+//
+//   cmake -DIP_ANONYMIZER_BUILD_BENCHMARKS=ON ... && ./anonymization_bench
+
+#include <chrono>
+#include <iostream>
+#include <random>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "Anonymization.hpp"
+#include "KeyedPseudonymization.hpp"
+
+namespace {
+
+const size_t RECORDS        = 1000000;
+const size_t BATCH_SIZE     = 1000;  // IPAnonymizer's MAX_POLL_BATCH_SIZE
+const size_t HEAVY_HITTERS  = 1000;
+const double HEAVY_FRACTION = 0.9;
+
+std::string randomIPv4(std::mt19937& rng) {
+    std::uniform_int_distribution<uint32_t> octet(0, 255);
+    return std::to_string(octet(rng)) + "." + std::to_string(octet(rng)) +
+           "." + std::to_string(octet(rng)) + "." + std::to_string(octet(rng));
+}
+
+std::vector<std::string> generateAddresses() {
+    std::mt19937 rng(42);
+
+    std::vector<std::string> heavy_hitters;
+    for (size_t i = 0; i < HEAVY_HITTERS; ++i) {
+        heavy_hitters.push_back(randomIPv4(rng));
+    }
+
+    // heavy hitters are Zipf-like: the n-th one is picked with weight 1/n
+    std::vector<double> weights;
+    for (size_t i = 1; i <= HEAVY_HITTERS; ++i) weights.push_back(1.0 / i);
+    std::discrete_distribution<size_t> pick_heavy(weights.begin(),
+                                                  weights.end());
+    std::bernoulli_distribution        is_heavy(HEAVY_FRACTION);
+
+    std::vector<std::string> addresses;
+    addresses.reserve(RECORDS);
+    for (size_t i = 0; i < RECORDS; ++i) {
+        addresses.push_back(is_heavy(rng) ? heavy_hitters[pick_heavy(rng)]
+                                          : randomIPv4(rng));
+    }
+    return addresses;
+}
+
+double benchmark(AnonymizationStrategy&          strategy,
+                 const std::vector<std::string>& addresses) {
+    clickhouse::ColumnString      column;
+    std::vector<std::string_view> batch;
+    batch.reserve(BATCH_SIZE);
+    column.Reserve(addresses.size());
+
+    auto start = std::chrono::steady_clock::now();
+    for (size_t offset = 0; offset < addresses.size(); offset += BATCH_SIZE) {
+        batch.clear();
+        for (size_t i = offset;
+             i < addresses.size() && i < offset + BATCH_SIZE; ++i) {
+            batch.push_back(addresses[i]);
+        }
+        strategy.transformBatch(batch, column);
+    }
+    auto elapsed = std::chrono::steady_clock::now() - start;
+
+    return std::chrono::duration<double, std::nano>(elapsed).count() /
+           addresses.size();
+}
+
+}  // namespace
+
+int main() {
+    std::vector<std::string> addresses = generateAddresses();
+
+    LastOctetAnonymization last_octet;
+    std::cout << "last octet:  " << benchmark(last_octet, addresses)
+              << " ns/record" << std::endl;
+
+    KeyedHash::Key secret{};
+    KeyedPseudonymization::parseSecret("000102030405060708090a0b0c0d0e0f",
+                                       secret);
+    KeyedPseudonymization pseudonymization(secret, std::chrono::hours(24));
+    std::cout << "pseudonyms:  " << benchmark(pseudonymization, addresses)
+              << " ns/record, AES-NI: "
+              << KeyedHash::isHardwareAccelerated() << std::endl;
+
+    const auto& stats = pseudonymization.getCacheStats();
+    std::cout << "cache hits:  "
+              << 100.0 * stats.hits / (stats.hits + stats.misses) << "%"
+              << std::endl;
+    return 0;
+}
@@ -0,0 +1,115 @@
+// Measures how long the anonymizer takes from construction to its first
+// consumed message while ClickHouse is unreachable or slow to come up.
+// Startup must not wait for the sinks, so time-to-first-message should stay
+// close to the Kafka group join time whatever CLICKHOUSE_HOST is.
+//
+//   cmake -DIP_ANONYMIZER_BUILD_BENCHMARKS=ON ... &&
+//   ./startup_bench [broker list] [clickhouse host]
+//
+// The defaults expect the broker of docker-compose.yml on localhost and a
+// non-routable ClickHouse address, so connecting to it hangs until timeout.
+
+#include <capnp/message.h>
+#include <capnp/serialize.h>
+#include <cppkafka/cppkafka.h>
+
+#include <chrono>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+#include <thread>
+
+#include "ClickHouseSink.hpp"
+#include "IPAnonymizer.hpp"
+#include "http_log.capnp.h"
+
+namespace {
+
+const std::string DEFAULT_BROKER_LIST     = "localhost:9092";
+const std::string DEFAULT_CLICKHOUSE_HOST = "10.255.255.1";
+const std::chrono::seconds TIMEOUT(60);
+const std::chrono::milliseconds POLL_INTERVAL(10);
+
+// one record in a topic of its own, so the consumer has something to read
+// as soon as it is assigned
+void produceRecord(const std::string& broker_list, const std::string& topic) {
+    cppkafka::Producer producer(cppkafka::Configuration{
+        {"metadata.broker.list", broker_list},
+    });
+
+    capnp::MallocMessageBuilder message;
+    auto record = message.initRoot<HttpLogRecord>();
+    record.setTimestampEpochMilli(
+        static_cast<uint64_t>(nowEpochMicros() / 1000));
+    record.setResourceId(1);
+    record.setBytesSent(512);
+    record.setRequestTimeMilli(10);
+    record.setResponseStatus(200);
+    record.setCacheStatus("HIT");
+    record.setMethod("GET");
+    record.setRemoteAddr("192.0.2.1");
+    record.setUrl("https://example.com/");
+    kj::Array<capnp::word> words = capnp::messageToFlatArray(message);
+    auto                   bytes = words.asBytes();
+    producer.produce(cppkafka::MessageBuilder(topic).payload(
+        cppkafka::Buffer(bytes.begin(), bytes.size())));
+    producer.flush(std::chrono::milliseconds(10000));
+}
+
+}  // namespace
+
+int main(int argc, char** argv) {
+    std::string broker_list     = argc > 1 ? argv[1] : DEFAULT_BROKER_LIST;
+    std::string clickhouse_host = argc > 2 ? argv[2] : DEFAULT_CLICKHOUSE_HOST;
+    std::string suffix          = std::to_string(nowEpochMicros());
+    std::string topic           = "startup_bench_" + suffix;
+
+    produceRecord(broker_list, topic);
+
+    cppkafka::Configuration kafka_config{
+        {"metadata.broker.list", broker_list},
+        {"group.id", "startup-bench-" + suffix},
+        {"enable.auto.commit", "false"},
+    };
+    kafka_config.set_default_topic_configuration(
+        {{"auto.offset.reset", "smallest"}});
+    clickhouse::ClientOptions clickhouse_config;
+    clickhouse_config.SetHost(clickhouse_host);
+    clickhouse_config.SetPort(9000);
+
+    auto latency_tracker = std::make_shared<LatencyTracker>();
+    // consumeAndBufferLogs() never returns, the anonymizer runs until exit
+    std::thread([=] {
+        std::vector<std::unique_ptr<Sink>> sinks;
+        sinks.push_back(std::make_unique<ClickHouseSink>(
+            clickhouse_config, SinkPolicy{std::chrono::seconds(60),
+                                          std::chrono::seconds(1), 5000000}));
+        IPAnonymizer anonymizer(kafka_config, std::move(sinks),
+                                std::make_shared<LastOctetAnonymization>(),
+                                std::make_shared<UrlNormalization>(
+                                    UrlNormalization::Options{}),
+                                latency_tracker);
+        anonymizer.consumeAndBufferLogs(topic, 100);
+    }).detach();
+
+    auto deadline = std::chrono::steady_clock::now() + TIMEOUT;
+    while (!latency_tracker->getMilestoneMicros("first message") &&
+           std::chrono::steady_clock::now() < deadline) {
+        std::this_thread::sleep_for(POLL_INTERVAL);
+    }
+
+    auto ms = [&](const std::string& milestone) -> std::string {
+        auto micros = latency_tracker->getMilestoneMicros(milestone);
+        return micros ? std::to_string(static_cast<double>(*micros) / 1000) +
+                            " ms"
+                      : "not reached";
+    };
+    std::cout << "ClickHouse at " << clickhouse_host << std::endl;
+    std::cout << "  subscribed           " << ms("subscribed") << std::endl;
+    std::cout << "  assigned             " << ms("assigned") << std::endl;
+    std::cout << "  first message        " << ms("first message") << std::endl;
+    std::cout << "  ready                " << ms("ready") << std::endl;
+
+    // the sinks' startup threads may still be stuck connecting
+    std::_Exit(latency_tracker->getMilestoneMicros("first message") ? 0 : 1);
+}
@@ -0,0 +1,86 @@
+#pragma once
+
+#include <clickhouse/client.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <vector>
+
+// Exact totals of the records that were not stored as raw rows, per Kafka
+// partition of a buffer and per key of the http_log_aggregated view. The
+// view only sees inserted rows, so these are inserted into it directly,
+// which keeps its totals exact while raw rows are sampled.
+class AggregatedTotals {
+   public:
+    // the aggregating view, an insert into it goes to its inner table
+    static constexpr const char* TABLE_NAME = "http_log_aggregated";
+
+    struct Key {
+        uint64_t    resource_id;
+        uint16_t    response_status;
+        std::string cache_status;
+        std::string remote_addr;  // anonymized
+
+        bool operator==(const Key& other) const = default;
+    };
+    struct Totals {
+        uint64_t bytes_sent = 0;
+        uint64_t requests   = 0;
+    };
+
+    // the view's columns, filled from one or more AggregatedTotals
+    struct Columns {
+        std::shared_ptr<clickhouse::ColumnUInt64> resource_id =
+            std::make_shared<clickhouse::ColumnUInt64>();
+        std::shared_ptr<clickhouse::ColumnUInt16> response_status =
+            std::make_shared<clickhouse::ColumnUInt16>();
+        std::shared_ptr<clickhouse::ColumnString> cache_status =
+            std::make_shared<clickhouse::ColumnString>();
+        std::shared_ptr<clickhouse::ColumnString> remote_addr =
+            std::make_shared<clickhouse::ColumnString>();
+        std::shared_ptr<clickhouse::ColumnUInt64> total_bytes_sent =
+            std::make_shared<clickhouse::ColumnUInt64>();
+        std::shared_ptr<clickhouse::ColumnUInt64> request_count =
+            std::make_shared<clickhouse::ColumnUInt64>();
+
+        void              append(const Key& key, const Totals& totals);
+        clickhouse::Block exportToBlockShallow() const;
+        void              clear();
+        inline size_t     size() const { return resource_id->Size(); }
+    };
+
+    void add(size_t partition, Key key, uint64_t bytes_sent);
+    // copies the totals of one partition of `from` into `partition`
+    void appendPartition(const AggregatedTotals& from, size_t from_partition,
+                         size_t partition);
+    void clear();
+    inline bool     empty() const { return records_ == 0; }
+    // records counted, i.e. the sum of all request counts
+    inline uint64_t getRecordCount() const { return records_; }
+
+    template <typename Visitor>
+    void forEach(Visitor&& visit) const {
+        for (const auto& partition : partitions_) {
+            for (const auto& [key, totals] : partition) visit(key, totals);
+        }
+    }
+    inline void appendTo(Columns& columns) const {
+        forEach([&columns](const Key& key, const Totals& totals) {
+            columns.append(key, totals);
+        });
+    }
+
+   private:
+    struct KeyHash {
+        size_t operator()(const Key& key) const;
+    };
+    using Map = std::unordered_map<Key, Totals, KeyHash>;
+
+    std::vector<Map> partitions_;  // by the buffer's partition index
+    uint64_t         records_ = 0;
+
+    Map& partition(size_t index);
+};
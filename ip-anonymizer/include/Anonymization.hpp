@@ -0,0 +1,43 @@
+#pragma once
+
+#include <clickhouse/client.h>
+
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "StageProfiler.hpp"
+
+// replaces the last octet of an IPv4 address with "X", e.g. 1.2.3.4 ->
+// 1.2.3.X. Anything without a dot is returned unchanged.
+std::string anonymizeIP(std::string_view ip_address);
+
+// How remote addresses are made GDPR-compliant before they are stored. The
+// generated column appender calls it on the consumer thread only, so
+// implementations may keep unsynchronized state.
+class AnonymizationStrategy {
+   public:
+    virtual ~AnonymizationStrategy() = default;
+
+    // appends the anonymized form of the address to the column
+    virtual void transform(std::string_view          address,
+                           clickhouse::ColumnString& column) = 0;
+    // the same for a whole column batch at once
+    virtual void transformBatch(const std::vector<std::string_view>& addresses,
+                                clickhouse::ColumnString&            column) {
+        StageProfiler::Scope scope(StageProfiler::Stage::ANONYMIZE,
+                                   addresses.size());
+        for (std::string_view address : addresses) {
+            transform(address, column);
+        }
+    }
+};
+
+// 1.2.3.4 -> 1.2.3.X, see anonymizeIP()
+class LastOctetAnonymization : public AnonymizationStrategy {
+   public:
+    void transform(std::string_view          address,
+                   clickhouse::ColumnString& column) override {
+        column.Append(anonymizeIP(address));
+    }
+};
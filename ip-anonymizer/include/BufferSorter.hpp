@@ -0,0 +1,76 @@
+#pragma once
+
+#include <condition_variable>
+#include <cstdint>
+#include <deque>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "ColumnBufferPool.hpp"
+
+// Sorts sealed buffers by the table's ORDER BY key, timestamp, on a thread of
+// its own while the consumer thread fills the next buffer. ClickHouse then
+// finds each inserted block already sorted and skips sorting it.
+//
+// The order is an LSD radix sort over the timestamps relative to the
+// buffer's minimum, one byte per pass, where passes over bytes that are equal
+// for all rows are skipped; a minute of data needs one or two passes. The
+// resulting permutation is applied to every column.
+class BufferSorter {
+   public:
+    struct Stats {
+        uint64_t buffers        = 0;
+        uint64_t already_sorted = 0;
+        uint64_t rows           = 0;
+        uint64_t sort_us        = 0;  // total, permutation and gather
+    };
+
+    // the stable permutation that sorts a timestamp column, its vectors are
+    // reused from one buffer to the next
+    class TimestampOrder {
+       public:
+        // returns false if the rows are in order already, get() is stale then
+        bool compute(const clickhouse::ColumnDateTime& timestamps);
+        // sorts all columns by timestamp, gathered into scratch and swapped
+        // in; returns false if they were in order already
+        bool sort(HttpLogRecordColumns& columns,
+                  HttpLogRecordColumns& scratch);
+        inline const std::vector<uint32_t>& get() const { return order_; }
+
+       private:
+        std::vector<uint64_t> keys_;
+        std::vector<uint64_t> keys_scratch_;
+        std::vector<uint32_t> order_;
+        std::vector<uint32_t> order_scratch_;
+    };
+
+    BufferSorter();
+    ~BufferSorter();
+
+    void submit(ColumnBufferPool::Handle buffer);
+    // the sorted buffers in submission order, with wait set once all of the
+    // submitted ones are done
+    std::vector<ColumnBufferPool::Handle> collect(bool wait);
+    Stats                                 getStats();
+
+   private:
+    std::mutex                           mutex_;
+    std::condition_variable              submitted_;
+    std::condition_variable              sorted_;
+    std::deque<ColumnBufferPool::Handle> input_;
+    std::deque<ColumnBufferPool::Handle> output_;
+    bool                                 busy_     = false;
+    bool                                 stopping_ = false;
+    Stats                                stats_;
+
+    // only used by the sorting thread
+    TimestampOrder       order_;
+    HttpLogRecordColumns columns_scratch_;
+
+    std::thread thread_;  // last, starts once everything else exists
+
+    void run();
+};
+
+std::ostream& operator<<(std::ostream& os, const BufferSorter::Stats& stats);
@@ -0,0 +1,39 @@
+#pragma once
+
+#include <clickhouse/client.h>
+
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+// Idle connections per ClickHouse endpoint, shared by the threads inserting
+// into different shards. A failed connect throws right away, so the caller
+// can fail over to another replica. Clients that failed are not released and
+// get dropped, the next acquire reconnects.
+class ClickHouseConnectionPool {
+   public:
+    // runs on the first connection to an endpoint, and again after the
+    // endpoint was invalidated, before the connection is handed out
+    using ConnectHook = std::function<void(clickhouse::Client&)>;
+
+    ClickHouseConnectionPool(std::vector<clickhouse::ClientOptions> endpoints,
+                             ConnectHook                            on_connect);
+
+    std::unique_ptr<clickhouse::Client> acquire(size_t endpoint);
+    void release(size_t endpoint, std::unique_ptr<clickhouse::Client> client);
+    // drops the idle connections and runs the hook again on the next one,
+    // e.g. after a failure that could mean the server was reset
+    void invalidate(size_t endpoint);
+
+    inline const clickhouse::ClientOptions& getOptions(size_t endpoint) const {
+        return endpoints_[endpoint];
+    }
+
+   private:
+    std::vector<clickhouse::ClientOptions>                        endpoints_;
+    ConnectHook                                                   on_connect_;
+    std::mutex                                                    mutex_;
+    std::vector<std::vector<std::unique_ptr<clickhouse::Client>>> idle_;
+    std::vector<bool>                                             hooked_;
+};
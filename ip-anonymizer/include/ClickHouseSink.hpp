@@ -0,0 +1,53 @@
+#pragma once
+
+#include <clickhouse/client.h>
+
+#include <chrono>
+#include <memory>
+
+#include "AggregatedTotals.hpp"
+#include "BufferSorter.hpp"
+#include "Sink.hpp"
+
+// inserts into the http_logs table, all buffers queued since the last flush
+// go out as a single insert to stay within the proxy's rate limit. While
+// records are shed, their totals are a second insert into the view, once
+// the rows are stored.
+class ClickHouseSink : public Sink {
+   public:
+    // does not connect, that happens in the background once started. With
+    // a storage report interval, the on-disk size and the server's part log
+    // are printed after an insert at most that often, which costs two more
+    // requests against the rate limit each time. With presorted buffers, a
+    // backlog of several is sorted again once merged into one block.
+    ClickHouseSink(const clickhouse::ClientOptions& options, SinkPolicy policy,
+                   std::chrono::seconds storage_report_interval = {},
+                   bool                 presorted               = false);
+    ~ClickHouseSink() override { stop(); }
+
+    // creates the table and the aggregating materialized view where they are
+    // missing and adds sample_weight to an older table, one query when all
+    // is there. Works on any node, e.g. every replica of a sharded cluster.
+    static void ensureTables(clickhouse::Client& client);
+
+   protected:
+    // connects and ensures the tables
+    void prepare() override;
+    void write(std::deque<SealedBuffer>& queue) override;
+
+   private:
+    clickhouse::ClientOptions             options_;
+    std::unique_ptr<clickhouse::Client>   ch_client_;
+    // shed totals of stored rows, not stored themselves yet
+    AggregatedTotals::Columns             pending_totals_;
+    std::chrono::seconds                  storage_report_interval_;  // 0: off
+    std::chrono::steady_clock::time_point next_storage_report_time_;
+    bool                                  presorted_;
+
+    // throws when the insert fails
+    void insertTotals();
+    // after a failed insert, prepare() runs again before the next write()
+    void dropConnection();
+    // prints the compressed size per row of the stored table and url column
+    void reportStorage();
+};
@@ -1,24 +1,120 @@
 #pragma once
 
+#include <capnp/serialize.h>
 #include <clickhouse/client.h>
 #include <cppkafka/buffer.h>
+#include <cppkafka/message.h>
+#include <cppkafka/topic_partition_list.h>
 
-#include "ColumnConfiguration.hpp"
+#include <algorithm>
+#include <deque>
+#include <memory>
+#include <vector>
+
+#include "AggregatedTotals.hpp"
+#include "Anonymization.hpp"
+#include "LatencyTracker.hpp"
+#include "UrlNormalization.hpp"
+#include "http_log.columns.h"
 
 namespace ch = clickhouse;
 
+// the column layout, the decoder and the table DDL are generated from
+// http_log.capnp by tools/capnpc-chcolumns, see http_log.columns.h
 class ColumnBuffer {
    public:
-    ColumnBuffer(const std::vector<ColTriplet> configs)
-        : col_triplet_vec_(configs) {}
-    ch::Block     exportToBlockShallow();
-    void          append(const cppkafka::Buffer& payload);
+    ColumnBuffer(std::shared_ptr<AnonymizationStrategy> anonymization,
+                 std::shared_ptr<UrlNormalization>      url_normalization)
+        : anonymization_(std::move(anonymization)),
+          url_normalization_(std::move(url_normalization)) {
+        columns_.anonymization     = anonymization_.get();
+        columns_.url_normalization = url_normalization_.get();
+    }
+
+    ch::Block exportToBlockShallow() const;
+    // decodes and validates all messages of one poll first, then fills the
+    // columns one field at a time across the whole batch. Malformed messages
+    // are skipped, their count is returned. With a sample factor above 1
+    // only the records LoadShedder::keep() picks become rows, weighted by
+    // the factor, the others are counted into getShedTotals().
+    size_t        appendBatch(const std::vector<cppkafka::Message>& messages,
+                              uint32_t sample_factor = 1);
+    // clears the rows, totals, offsets and watermarks, fixed-width columns
+    // keep their capacity
     void          clearColumns();
-    inline size_t getRowCount() {
-        return col_triplet_vec_.empty() ? 0
-                                        : col_triplet_vec_[0].col_ptr->Size();
+    // copies the rows of the given partitions into `moved` and all others
+    // into `kept`, both empty, along with their offsets
+    void          splitPartitions(const cppkafka::TopicPartitionList& partitions,
+                                  ColumnBuffer& moved, ColumnBuffer& kept) const;
+    // reorders all rows, row i becomes order[i]. The rows are gathered into
+    // scratch, whose columns are then swapped in, so a reused scratch saves
+    // the allocations.
+    void          permute(const std::vector<uint32_t>& order,
+                          HttpLogRecordColumns&        scratch);
+    // stamps the seal time, after which the buffer is only read
+    inline void   seal() { watermarks_.seal_us = nowEpochMicros(); }
+    inline void   reserve(size_t rows) {
+        peak_rows_ = std::max(peak_rows_, rows);
+        columns_.reserve(rows);
+    }
+    inline size_t getRowCount() const { return columns_.size(); }
+    // the most rows the columns held or were reserved for since the buffer
+    // was built, what the fixed-width columns keep room for
+    inline size_t getPeakRows() const {
+        return std::max(peak_rows_, getRowCount());
+    }
+    // neither rows nor shed records to store
+    inline bool   empty() const {
+        return getRowCount() == 0 && shed_totals_.empty();
+    }
+    inline void   exportRow(size_t row, HttpLogRecord::Builder record) const {
+        columns_.exportRow(row, record);
+    }
+    inline const HttpLogRecordColumns& getColumns() const { return columns_; }
+    inline const AggregatedTotals&     getShedTotals() const {
+        return shed_totals_;
+    }
+    // records of the last appendBatch() that were counted but not stored
+    inline size_t getLastBatchShedCount() const {
+        return batch_shed_records_.size();
+    }
+    // per partition, the offset after the last message consumed into the
+    // buffer, i.e. the offset to commit once the buffer is stored
+    inline const cppkafka::TopicPartitionList& getOffsets() const {
+        return offsets_;
+    }
+    inline const BatchWatermarks& getWatermarks() const { return watermarks_; }
+    inline const BatchWatermarks& getLastBatchWatermarks() const {
+        return last_batch_watermarks_;
     }
 
    private:
-    std::vector<ColTriplet> col_triplet_vec_;
+    std::shared_ptr<AnonymizationStrategy> anonymization_;
+    std::shared_ptr<UrlNormalization>      url_normalization_;
+    HttpLogRecordColumns                   columns_;
+    BatchWatermarks                        watermarks_;
+    BatchWatermarks                        last_batch_watermarks_;
+    cppkafka::TopicPartitionList           offsets_;
+    std::vector<uint16_t>                  partition_of_row_;  // in offsets_
+    AggregatedTotals                       shed_totals_;
+    size_t                                 peak_rows_ = 0;
+
+    // reused between batches, so a steady stream of polls does not allocate
+    std::vector<capnp::word>                  batch_arena_;
+    std::deque<capnp::FlatArrayMessageReader> batch_readers_;
+    std::vector<HttpLogRecord::Reader>        batch_records_;
+    std::vector<HttpLogRecord::Reader>        batch_shed_records_;
+    std::vector<uint16_t>                     batch_shed_partitions_;
+    std::vector<std::string_view>             shed_addresses_;
+    ch::ColumnString                          shed_anonymized_;
+
+    void   updateWatermarks(const std::vector<cppkafka::Message>& messages,
+                            int64_t                               consume_us);
+    // index of the message's partition in offsets_, whose offset it advances
+    size_t trackOffset(const cppkafka::Message& message);
+    // anonymizes the batch's shed records and adds them to shed_totals_
+    void   countShedRecords();
+    void   appendRows(const ColumnBuffer&          from,
+                      const std::vector<uint32_t>& rows,
+                      const std::vector<bool>&     partitions);
 };
@@ -0,0 +1,62 @@
+#pragma once
+
+#include <memory>
+#include <mutex>
+#include <ostream>
+#include <vector>
+
+#include "ColumnBuffer.hpp"
+
+// Hands out pre-sized ColumnBuffers and takes them back once the last
+// reference is gone. Returned buffers are cleared and re-reserved while idle,
+// on the thread that returns them. The pre-size follows the largest buffer of
+// the last RESIZE_WINDOW returns, but never drops below the configured one, so
+// in steady state filling a buffer up to a typical flush does not grow any
+// column. A buffer that grew far beyond the pre-size, e.g. while a backlog
+// was drained, is replaced by a new one, which gives its memory back.
+class ColumnBufferPool {
+   public:
+    using Handle = std::shared_ptr<ColumnBuffer>;
+
+    struct Stats {
+        size_t buffers_created      = 0;
+        size_t buffers_in_use       = 0;
+        size_t max_buffers_in_use   = 0;  // high-water mark
+        size_t max_rows_per_buffer  = 0;  // high-water mark
+        size_t reserved_rows        = 0;  // current pre-size of the buffers
+        size_t acquired_from_pool   = 0;
+        size_t acquired_newly_built = 0;
+    };
+
+    ColumnBufferPool(size_t preallocated_buffers, size_t reserved_rows,
+                     std::shared_ptr<AnonymizationStrategy> anonymization,
+                     std::shared_ptr<UrlNormalization>      url_normalization);
+
+    Handle acquire();
+    Stats  getStats() const;
+
+   private:
+    static constexpr size_t RESIZE_WINDOW = 16;
+
+    struct State {
+        std::mutex                                 mutex;
+        std::vector<std::unique_ptr<ColumnBuffer>> free_buffers;
+        Stats                                      stats;
+        size_t                                     configured_rows = 0;
+        size_t                                     window_max_rows = 0;
+        size_t                                     window_returns  = 0;
+        // set once, read without the lock
+        std::shared_ptr<AnonymizationStrategy>     anonymization;
+        std::shared_ptr<UrlNormalization>          url_normalization;
+    };
+
+    // the deleters of outstanding handles keep the state alive, so handles
+    // may outlive the pool itself
+    std::shared_ptr<State> state_;
+
+    static std::unique_ptr<ColumnBuffer> makeBuffer(State& state);
+    static void release(const std::shared_ptr<State>& state,
+                        ColumnBuffer*                 buffer);
+};
+
+std::ostream& operator<<(std::ostream& os, const ColumnBufferPool::Stats& stats);
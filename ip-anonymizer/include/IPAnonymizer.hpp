@@ -1,33 +1,80 @@
 #pragma once
 
-#include <clickhouse/client.h>
 #include <cppkafka/cppkafka.h>
 
+#include <chrono>
+#include <deque>
+#include <memory>
 #include <string>
 #include <vector>
 
-#include "ClickHouseClientFactory.hpp"
+#include "Anonymization.hpp"
+#include "BufferSorter.hpp"
 #include "ColumnBuffer.hpp"
+#include "ColumnBufferPool.hpp"
+#include "LatencyTracker.hpp"
+#include "LoadShedder.hpp"
+#include "Sink.hpp"
+#include "UrlNormalization.hpp"
 
+// Consumes with auto commit off: offsets are committed once every sink has
+// stored the rows, and on a rebalance the rows of the revoked partitions are
+// flushed and committed before the partitions are handed over.
+// Consumption starts right away, sinks connect in the background and keep
+// their queue until they are ready.
 class IPAnonymizer {
    public:
-    IPAnonymizer(cppkafka::Configuration          kafka_consumer_config,
-                 const clickhouse::ClientOptions& clickhouse_config);
+    IPAnonymizer(cppkafka::Configuration                kafka_consumer_config,
+                 std::vector<std::unique_ptr<Sink>>     sinks,
+                 std::shared_ptr<AnonymizationStrategy> anonymization,
+                 std::shared_ptr<UrlNormalization>      url_normalization,
+                 std::shared_ptr<LatencyTracker>        latency_tracker,
+                 std::unique_ptr<BufferSorter>          sorter = nullptr,
+                 std::unique_ptr<LoadShedder>           load_shedder = nullptr);
+    ~IPAnonymizer();
 
-    void consumeAndBufferLogs(const std::string& topic, int timeout);
+    // created once every sink is ready, e.g. for a readiness probe
+    inline void setReadyFile(const std::string& path) { ready_file_ = path; }
+    void        consumeAndBufferLogs(const std::string& topic, int timeout);
 
    private:
-    IPAnonymizer(std::unique_ptr<cppkafka::Consumer>&& consumer,
-                 std::unique_ptr<clickhouse::Client>&& chClient)
-        : consumer_(std::move(consumer)), ch_client_(std::move(chClient)) {}
-
-    std::unique_ptr<cppkafka::Consumer> consumer_;
-    std::unique_ptr<clickhouse::Client> ch_client_;
-
-    std::string anonymizeIP(const std::string ip_address);
-    void        handleMessageError(const cppkafka::Error& error);
-    bool        shouldInsert(
-               const std::chrono::system_clock::time_point& lastInsertTime) const;
-    void attemptInsert(ColumnBuffer&                          buffer,
-                       std::chrono::system_clock::time_point& lastInsertTime);
+    // a sealed buffer whose offsets can be committed once it expires, i.e.
+    // the last sink is done with it
+    struct InFlightBuffer {
+        std::weak_ptr<const ColumnBuffer> buffer;
+        cppkafka::TopicPartitionList      offsets;
+    };
+
+    std::unique_ptr<cppkafka::Consumer>   consumer_;
+    std::vector<std::unique_ptr<Sink>>    sinks_;
+    ColumnBufferPool                      buffer_pool_;
+    std::shared_ptr<UrlNormalization>     url_normalization_;
+    std::shared_ptr<LatencyTracker>       latency_tracker_;
+    std::unique_ptr<BufferSorter>         sorter_;        // optional
+    std::unique_ptr<LoadShedder>          load_shedder_;  // optional
+    std::chrono::milliseconds             revocation_timeout_;
+    bool                                  paused_ = false;
+    ColumnBufferPool::Handle              buffer_;
+    std::chrono::system_clock::time_point last_seal_time_;
+    std::deque<InFlightBuffer>            in_flight_;
+    cppkafka::TopicPartitionList          assignment_;
+    std::vector<bool>                     sinks_ready_;
+    bool                                  ready_ = false;
+    std::string                           ready_file_;
+
+    void handleMessageError(const cppkafka::Error& error);
+    // records the sinks that became ready since the last call
+    void updateReadiness();
+    bool shouldSeal() const;
+    // hands a filled buffer to every sink, through the sorter if there is one
+    void sealBuffer(ColumnBufferPool::Handle buffer);
+    void enqueueSealed(SealedBuffer buffer);
+    // enqueues the buffers the sorter is done with, with wait set all of them
+    void collectSorted(bool wait);
+    // pauses consumption while any sink has too much queued
+    void applyBackpressure();
+    // commits the offsets of the buffers all sinks have stored
+    void commitStoredOffsets(bool synchronous);
+    void handleAssignment(const cppkafka::TopicPartitionList& partitions);
+    void handleRevocation(const cppkafka::TopicPartitionList& partitions);
 };
@@ -0,0 +1,49 @@
+#pragma once
+
+#include <capnp/message.h>
+#include <cppkafka/cppkafka.h>
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "Sink.hpp"
+
+// re-publishes the anonymized rows as HttpLogRecord messages to another
+// Kafka topic. Delivery is at least once: every message of a buffer is
+// tracked until its delivery report, and when the flush times out or some
+// fail, only the ones without a successful report are produced again. Every
+// message carries the weight of its row in a sample_weight header, above 1
+// while records are shed.
+class KafkaSink : public Sink {
+   public:
+    KafkaSink(cppkafka::Configuration producer_config, std::string topic,
+              SinkPolicy policy);
+    ~KafkaSink() override { stop(); }
+
+   protected:
+    void write(std::deque<SealedBuffer>& queue) override;
+
+   private:
+    // the rows of the buffer being written that were delivered, set by the
+    // delivery report callback, which runs on the writer thread within
+    // poll() and flush()
+    struct Deliveries {
+        // reports of a buffer written before carry another generation
+        uint32_t             generation = 0;
+        std::vector<uint8_t> delivered;
+    };
+
+    std::string                         topic_;
+    std::unique_ptr<cppkafka::Producer> producer_;
+    std::shared_ptr<Deliveries>         deliveries_;
+    SealedBuffer                        tracked_;  // whose rows are tracked
+    // reused for every row: the first segment of the message builder,
+    // which has to be zeroed, and the serialized message
+    std::vector<capnp::word>            segment_;
+    std::vector<capnp::word>            payload_;
+
+    void produce(const cppkafka::MessageBuilder& builder);
+    void produceRow(const ColumnBuffer& buffer, size_t row);
+};
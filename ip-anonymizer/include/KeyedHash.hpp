@@ -0,0 +1,36 @@
+#pragma once
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+
+// 128-bit keyed pseudo-random function. Inputs of up to 15 bytes, e.g. IPv4
+// addresses, take a single AES-128 block encryption, which AES-NI does in a
+// few cycles where the CPU has it; a portable implementation gives identical
+// results elsewhere, so pseudonyms do not depend on the hardware. Longer
+// inputs go through HMAC-SHA256 from OpenSSL, truncated to 128 bits, with a
+// key derived from the AES key.
+class KeyedHash {
+   public:
+    using Key    = std::array<uint8_t, 16>;
+    using Digest = std::array<uint64_t, 2>;
+
+    explicit KeyedHash(const Key& key);
+
+    void   setKey(const Key& key);
+    Digest hash128(const void* data, size_t length) const;
+    inline uint64_t hash64(const void* data, size_t length) const {
+        return hash128(data, length)[0];
+    }
+
+    static bool isHardwareAccelerated();
+
+   private:
+    using Block = std::array<uint8_t, 16>;
+
+    alignas(16) std::array<Block, 11> round_keys_;
+    Key  mac_key_;
+    bool use_aesni_;
+
+    void encrypt(Block& block) const;
+};
@@ -0,0 +1,64 @@
+#pragma once
+
+#include <array>
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+
+#include "Anonymization.hpp"
+#include "KeyedHash.hpp"
+
+// Replaces addresses with keyed pseudonyms, so per-client analytics keep
+// working without storing the address. An IPv4 address keeps its /24 and gets
+// its last octet mapped through a keyed permutation of that /24, so distinct
+// clients stay distinct: 1.2.3.4 -> 1.2.3.187. Anything else becomes a
+// truncated keyed hash, "h:0123456789abcdef".
+//
+// The key is derived from a secret and the index of the current rotation
+// period; pseudonyms change when the period does. Heavy-hitter IPv4
+// addresses are served from a bounded, cache-line-aligned 2-way cache.
+class KeyedPseudonymization : public AnonymizationStrategy {
+   public:
+    struct CacheStats {
+        uint64_t hits   = 0;
+        uint64_t misses = 0;
+    };
+
+    KeyedPseudonymization(const KeyedHash::Key& secret,
+                          std::chrono::seconds  rotation_period);
+
+    void transform(std::string_view          address,
+                   clickhouse::ColumnString& column) override;
+    void transformBatch(const std::vector<std::string_view>& addresses,
+                        clickhouse::ColumnString&            column) override;
+
+    inline const CacheStats& getCacheStats() const { return cache_stats_; }
+
+    // parses 32 hex digits, returns false on anything else
+    static bool parseSecret(std::string_view hex, KeyedHash::Key& secret);
+
+   private:
+    // 24 bytes, two entries per cache line
+    struct CacheEntry {
+        uint32_t address;
+        uint32_t period;  // 0 marks an empty entry
+        uint8_t  length;
+        char     text[15];
+    };
+    struct alignas(64) CacheSet {
+        CacheEntry entries[2];  // most recently used first
+    };
+    static constexpr size_t CACHE_SETS = 2048;  // 128 KiB
+
+    KeyedHash                   secret_hash_;  // derives the period keys
+    KeyedHash                   hash_;         // keyed with the period key
+    std::chrono::seconds        rotation_period_;
+    uint32_t                    period_ = 0;
+    std::unique_ptr<CacheSet[]> cache_;
+    CacheStats                  cache_stats_;
+
+    void   rotateKeyIfNeeded();
+    void   append(std::string_view address, clickhouse::ColumnString& column);
+    size_t pseudonymizeIPv4(uint32_t address, char* out) const;
+};
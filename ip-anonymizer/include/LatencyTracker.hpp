@@ -0,0 +1,109 @@
+#pragma once
+
+#include <array>
+#include <cstdint>
+#include <fstream>
+#include <limits>
+#include <map>
+#include <mutex>
+#include <optional>
+#include <ostream>
+#include <string>
+
+// microseconds since the Unix epoch on the local wall clock, comparable with
+// the event and Kafka timestamps as long as the clocks are in sync
+int64_t nowEpochMicros();
+
+// event-time and processing-time bounds of the rows in one ColumnBuffer, in
+// microseconds since the Unix epoch
+struct BatchWatermarks {
+    static constexpr int64_t UNSET_MIN = std::numeric_limits<int64_t>::max();
+    static constexpr int64_t UNSET_MAX = std::numeric_limits<int64_t>::min();
+
+    int64_t min_event_us     = UNSET_MIN;  // timestampEpochMilli
+    int64_t max_event_us     = UNSET_MAX;
+    int64_t min_kafka_us     = UNSET_MIN;  // Kafka message timestamp
+    int64_t max_kafka_us     = UNSET_MAX;
+    int64_t first_consume_us = 0;
+    int64_t last_consume_us  = 0;
+    int64_t seal_us          = 0;
+
+    void        merge(const BatchWatermarks& other);
+    inline bool empty() const { return first_consume_us == 0; }
+};
+
+// log2-bucketed histogram of durations in microseconds
+class LatencyHistogram {
+   public:
+    void record(int64_t micros);
+
+    inline uint64_t getCount() const { return count_; }
+    inline int64_t  getMax() const { return max_; }
+    // upper bound of the bucket holding the given quantile, p in [0, 1]
+    int64_t percentile(double p) const;
+
+   private:
+    static constexpr size_t BUCKETS = 48;
+
+    std::array<uint64_t, BUCKETS> buckets_{};
+    uint64_t                      count_ = 0;
+    int64_t                       max_   = 0;
+};
+
+// Collects per-stage latency histograms from the watermarks that travel with
+// every buffer and optionally writes one Chrome trace event per stage and
+// buffer (open the file in chrome://tracing or https://ui.perfetto.dev):
+//   kafka->consume      Kafka timestamp of the oldest message to its poll
+//   event->consume      event time of the oldest message to its poll
+//   decode              duration of one batch decode
+//   consume->seal       first row of a buffer to the buffer being sealed
+//   <sink> seal->flush  sink queue and flush-interval (rate limit) wait
+//   <sink> flush->ack   the write itself, e.g. network and insert
+//   <sink> end-to-end   event time of the oldest row to its acknowledgement
+// Startup milestones, e.g. "first message", are timed from the tracker's
+// construction and show up as instant events in the trace.
+//
+// The histograms cover the time since the previous report. Trace events are
+// buffered and written out on each report; once the file reaches
+// max_trace_bytes it is renamed to <path>.1, replacing the previous one, and
+// a new file is started, so at most twice that is kept on disk.
+class LatencyTracker {
+   public:
+    static constexpr size_t DEFAULT_MAX_TRACE_BYTES = 64 << 20;
+
+    // an empty path disables the trace file
+    explicit LatencyTracker(const std::string& trace_path = "",
+                            size_t max_trace_bytes = DEFAULT_MAX_TRACE_BYTES);
+
+    void recordPoll(const BatchWatermarks& batch, size_t messages,
+                    int64_t decode_start_us, int64_t decode_end_us);
+    void recordSeal(const BatchWatermarks& buffer, size_t rows);
+    void recordFlush(const std::string& sink, const BatchWatermarks& buffer,
+                     size_t rows, int64_t flush_start_us, int64_t ack_us);
+    // only the first occurrence of a milestone is kept and logged
+    void recordMilestone(const std::string& name);
+    // microseconds from construction to the milestone, if reached
+    std::optional<int64_t> getMilestoneMicros(const std::string& name);
+
+    // prints the histograms and starts new ones
+    void report(std::ostream& os);
+
+   private:
+    const int64_t                           created_us_;
+    std::mutex                              mutex_;
+    std::map<std::string, LatencyHistogram> histograms_;
+    std::map<std::string, int64_t>          milestones_;
+    const std::string                       trace_path_;
+    const size_t                            max_trace_bytes_;
+    std::ofstream                           trace_;
+    size_t                                  trace_bytes_ = 0;
+    std::map<std::string, int>              trace_threads_;
+
+    // called with mutex_ held
+    int  traceThread(const std::string& name);
+    void traceEvent(const std::string& name, int thread, int64_t start_us,
+                    int64_t end_us, size_t rows);
+    void writeTrace(const std::string& event);
+    // starts the file with the thread names, the viewer needs them
+    void openTrace();
+};
@@ -0,0 +1,60 @@
+#pragma once
+
+#include <chrono>
+#include <cstdint>
+#include <memory>
+#include <ostream>
+
+#include "LatencyTracker.hpp"
+#include "MetricsExporter.hpp"
+
+// Overload policy of the ingest path. While the consumer lags more than
+// lag_threshold behind the newest Kafka timestamps, only a deterministic
+// sample of the records is stored as raw rows, each with the sampling
+// factor as its sample_weight. The records left out are still counted into
+// exact totals, see AggregatedTotals. Once per adjust_interval the factor
+// doubles while the lag is above the threshold, and halves while it is below
+// recovery_lag, back to 1.
+class LoadShedder {
+   public:
+    struct Options {
+        // 0 never sheds, the lag is only reported
+        std::chrono::seconds lag_threshold{0};
+        std::chrono::seconds recovery_lag{60};
+        std::chrono::seconds adjust_interval{10};
+        uint32_t             max_sample_factor = 64;
+    };
+
+    struct Stats {
+        uint64_t records       = 0;  // consumed
+        uint64_t shed          = 0;  // counted only, not stored as rows
+        uint32_t sample_factor = 1;
+        int64_t  lag_us        = 0;
+    };
+
+    explicit LoadShedder(Options                          options,
+                         std::shared_ptr<MetricsExporter> metrics = nullptr);
+
+    // whether a record is stored as a row when 1 in `factor` is kept. It only
+    // depends on the record's partition and offset, so a re-read keeps the
+    // same records, and with factors that are powers of two a record kept at
+    // 2n is kept at n too.
+    static bool keep(int32_t partition, int64_t offset, uint32_t factor);
+
+    inline uint32_t     getSampleFactor() const { return stats_.sample_factor; }
+    inline const Stats& getStats() const { return stats_; }
+
+    // called after every poll that was not paused, with the poll's
+    // watermarks; a poll without messages means the consumer caught up
+    void update(const BatchWatermarks& batch, size_t records, size_t shed);
+
+   private:
+    Options                               options_;
+    std::shared_ptr<MetricsExporter>      metrics_;  // optional
+    Stats                                 stats_;
+    std::chrono::steady_clock::time_point next_adjust_time_;
+
+    void publish();
+};
+
+std::ostream& operator<<(std::ostream& os, const LoadShedder::Stats& stats);
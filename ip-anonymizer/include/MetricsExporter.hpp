@@ -0,0 +1,39 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <map>
+#include <mutex>
+#include <string>
+#include <thread>
+
+// Serves the latest value of every metric in the Prometheus text format, on
+// any path of a plain HTTP port, from a thread of its own. Values may be set
+// from any thread.
+class MetricsExporter {
+   public:
+    enum class Type { GAUGE, COUNTER };
+
+    // throws when the port cannot be bound
+    explicit MetricsExporter(uint16_t port);
+    ~MetricsExporter();
+
+    void set(const std::string& name, Type type, const std::string& help,
+             double value);
+
+   private:
+    struct Metric {
+        Type        type;
+        std::string help;
+        double      value;
+    };
+
+    int                           listen_fd_;
+    std::mutex                    mutex_;
+    std::map<std::string, Metric> metrics_;
+    std::atomic<bool>             stopping_ = false;
+    std::thread                   thread_;
+
+    void        serve();
+    std::string render();
+};
@@ -0,0 +1,26 @@
+#pragma once
+
+#include <clickhouse/base/output.h>
+
+#include <string>
+
+#include "Sink.hpp"
+
+// Writes every sealed buffer as a block in ClickHouse Native format to an
+// hourly file, <directory>/http_logs-YYYYMMDD-HH.native (UTC), for cold
+// storage. The files can be read back with e.g.
+// clickhouse-local --input-format Native --query "SELECT ..." < file
+class NativeFileSink : public Sink {
+   public:
+    NativeFileSink(std::string directory, SinkPolicy policy);
+    ~NativeFileSink() override { stop(); }
+
+   protected:
+    void write(std::deque<SealedBuffer>& queue) override;
+
+   private:
+    std::string        directory_;
+    clickhouse::Buffer serialized_;  // reused between blocks
+
+    std::string currentFilePath() const;
+};
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <clickhouse/client.h>
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+#include "AggregatedTotals.hpp"
+#include "BufferSorter.hpp"
+#include "ClickHouseConnectionPool.hpp"
+#include "Sink.hpp"
+
+// Inserts into a cluster of ClickHouse shards, each with one or more
+// replicas. Every flush is split by shard, intHash64(resource_id) % shards
+// like a Distributed table with that sharding key would, and the shards are
+// inserted in parallel, so throughput grows with the number of nodes. Since
+// resource_id leads the aggregating view's key, each node's view is complete
+// for its resources.
+//
+// Every shard has a worker thread of its own that inserts its share of a
+// flush. A shard is written to its last working replica, the others are
+// tried when it fails. A replica that failed is reconnected by the worker in
+// the background, and while no replica of a shard is up the shard is parked:
+// flushes skip it right away and keep its rows queued. Shards that were
+// stored are not inserted again when a flush is retried for the remaining
+// ones. Tables should be ReplicatedMergeTree for replicas to see each
+// other's data and to deduplicate an insert retried on another replica;
+// prepare() only creates missing tables.
+class ShardedClickHouseSink : public Sink {
+   public:
+    // shards of replicas
+    using Topology = std::vector<std::vector<clickhouse::ClientOptions>>;
+
+    // starts the shard workers, which connect on the first flush. With
+    // presorted buffers, a shard's rows from several are sorted again.
+    ShardedClickHouseSink(const Topology& topology, SinkPolicy policy,
+                          bool presorted = false);
+    ~ShardedClickHouseSink() override;
+
+    // "host:port,host:port;host:port", shards separated by ';' and replicas
+    // by ','. Options not in the list are taken from defaults.
+    static bool parseTopology(std::string_view                 spec,
+                              const clickhouse::ClientOptions& defaults,
+                              Topology&                        topology);
+
+    // ClickHouse's intHash64
+    static inline uint64_t intHash64(uint64_t x) {
+        x ^= x >> 33;
+        x *= 0xff51afd7ed558ccdULL;
+        x ^= x >> 33;
+        x *= 0xc4ceb9fe1a85ec53ULL;
+        x ^= x >> 33;
+        return x;
+    }
+
+   protected:
+    // connects to every reachable replica, which ensures the tables there,
+    // throws unless each shard has at least one. A replica that comes up
+    // later gets its tables on its first connection.
+    void prepare() override;
+    void write(std::deque<SealedBuffer>& queue) override;
+    // a flush in progress that loses buffers is split again from scratch
+    void discarding(const std::vector<bool>& discarded) override;
+
+   private:
+    struct Replica {
+        size_t endpoint;     // in pool_
+        bool   up = true;    // only the shard's worker touches it
+    };
+    struct Shard {
+        std::vector<Replica>      replicas;
+        size_t                    preferred = 0;  // the last working replica
+        // this shard's rows and totals of shed records of the flush in
+        // progress, until they are stored
+        HttpLogRecordColumns      rows;
+        AggregatedTotals::Columns totals;
+        bool                      rows_stored = false;
+        bool                      pending     = false;
+        std::vector<uint32_t>     row_indices;  // scratch of partition()
+
+        // guarded by mutex, changed is notified on every change
+        std::mutex                mutex;
+        std::condition_variable   changed;
+        bool                      inserting = false;  // handed to the worker
+        bool                      parked    = false;  // no replica is up
+        std::string               error;  // of the last insert, if it failed
+        std::thread               worker;
+    };
+
+    ClickHouseConnectionPool     pool_;
+    // a deque, shards are neither copied nor moved
+    std::deque<Shard>            shards_;
+    std::atomic<bool>            stopping_workers_ = false;
+    // buffers at the front of the queue that are split into the shards
+    size_t                       pending_buffers_ = 0;
+    std::vector<uint32_t>        shard_of_row_;
+    bool                         presorted_;
+    BufferSorter::TimestampOrder order_;
+    HttpLogRecordColumns         sort_scratch_;
+
+    void partition(const ColumnBuffer& buffer);
+    // the worker of a shard: inserts what write() hands over and reconnects
+    // the replicas that are down in between
+    void runShard(size_t shard_index);
+    // throws when no replica took the rows, the shard is parked then
+    void insertShard(size_t shard_index);
+    // tries to connect every replica that is down, unparks the shard once
+    // one is up
+    void reconnectReplicas(size_t shard_index);
+};
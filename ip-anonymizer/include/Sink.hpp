@@ -0,0 +1,119 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <deque>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "ColumnBuffer.hpp"
+#include "LatencyTracker.hpp"
+
+// sealed buffers are shared read-only between all sinks, the last sink done
+// with a buffer returns it to the ColumnBufferPool
+using SealedBuffer = std::shared_ptr<const ColumnBuffer>;
+
+struct SinkPolicy {
+    // minimum time between two successful flushes
+    std::chrono::seconds flush_interval;
+    // delay before retrying a failed flush
+    std::chrono::seconds retry_delay;
+    // the sink asks the consumer to pause once this many rows are queued
+    size_t max_queued_rows;
+};
+
+// A destination of the anonymized stream with its own queue, flush policy and
+// backpressure. Decoding happens once, every sink is handed the same sealed
+// buffers and reads the column data in place.
+//
+// Every sink writes on a thread of its own, so a slow sink holds up neither
+// consumption nor the other sinks; the consumer thread only enqueues and
+// checks for backpressure, which bounds the queue to about max_queued_rows.
+// The writer first runs prepare(), retried every retry_delay until it
+// succeeds. Until then the sink is not ready and writes nothing, buffers
+// queue up and consumption goes on until the queue is full. A write() that
+// finds its connection broken calls reconnect() and the writer goes through
+// the same warm-up again.
+class Sink {
+   public:
+    Sink(std::string name, SinkPolicy policy)
+        : name_(std::move(name)), policy_(policy) {}
+    // a derived sink that overrides prepare() or write() calls stop() in its
+    // destructor, neither must run on a half-destroyed sink
+    virtual ~Sink() { stop(); }
+
+    // starts the writer thread
+    void start();
+    // waits for a prepare() or write() in progress and ends the writer,
+    // buffers still queued are not written
+    void stop();
+    inline bool isReady() const {
+        return ready_.load(std::memory_order_acquire);
+    }
+
+    // before start()
+    inline void setLatencyTracker(std::shared_ptr<LatencyTracker> tracker) {
+        latency_tracker_ = std::move(tracker);
+    }
+
+    void enqueue(SealedBuffer buffer);
+    // has the writer flush right away, regardless of the policy, e.g. before
+    // partitions are handed to another consumer
+    void requestFlush();
+    // returns whether the queue ran empty before the deadline
+    bool waitUntilEmpty(std::chrono::steady_clock::time_point deadline);
+    // drops the queued buffers that only hold rows of the given partitions,
+    // e.g. ones handed over unstored, which their new owner reads again. A
+    // write in progress is waited for until the deadline, its buffers are
+    // kept if it is still going then. Returns the number of rows dropped.
+    size_t discard(const cppkafka::TopicPartitionList&   partitions,
+                   std::chrono::steady_clock::time_point deadline);
+
+    inline const std::string& getName() const { return name_; }
+    inline size_t             getQueuedRows() const { return queued_rows_; }
+    inline bool               isSaturated() const {
+        return queued_rows_ >= policy_.max_queued_rows;
+    }
+
+   protected:
+    // connects and creates what the sink writes to, throws on failure. Runs
+    // on the writer thread, before any write().
+    virtual void prepare() {}
+    // writes queued buffers in order and pops the ones that are stored
+    // durably. Throws on failure, buffers still queued are retried later.
+    // Runs on the writer thread, the queue is its own copy.
+    virtual void write(std::deque<SealedBuffer>& queue) = 0;
+    // called by discard() before the flagged buffers leave the queue, for
+    // sinks that keep state about a write in progress. The writer is idle.
+    virtual void discarding(const std::vector<bool>& /*discarded*/) {}
+    // called from write() when what prepare() set up is broken: the sink is
+    // not ready and prepare() runs again before the next write()
+    inline void reconnect() { ready_.store(false, std::memory_order_release); }
+
+   private:
+    std::string                           name_;
+    SinkPolicy                            policy_;
+    std::shared_ptr<LatencyTracker>       latency_tracker_;
+    std::thread                           writer_;
+    std::atomic<bool>                     ready_       = false;
+    std::atomic<size_t>                   queued_rows_ = 0;
+
+    // guarded by mutex_, changed_ is notified on every change
+    std::mutex                            mutex_;
+    std::condition_variable               changed_;
+    std::deque<SealedBuffer>              queue_;
+    // buffers at the front of queue_ that are handed to write()
+    size_t                                writing_  = 0;
+    bool                                  stopping_ = false;
+    std::chrono::steady_clock::time_point next_flush_time_;
+
+    void run();
+    // runs prepare() until it succeeds, false when stopped before
+    bool warmUp(std::unique_lock<std::mutex>& lock);
+    // one write() of a copy of the queue, the lock is released meanwhile
+    void flush(std::unique_lock<std::mutex>& lock);
+};
@@ -0,0 +1,101 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+
+// Per-stage CPU profile of the pipeline, enabled with --profile. Every stage
+// is wrapped in a Scope, which takes the wall time, the cycles, instructions
+// and cache misses of its thread (Linux perf_event_open, where permitted)
+// and the number of allocations at its start and end. Scopes nest: a stage
+// is charged its own cost only, e.g. append without the anonymize inside it.
+// The append is also broken down per column, see ColumnScope.
+//
+// The profiler is process-wide since the stages are spread over many classes
+// and threads. When disabled a Scope costs one branch.
+class StageProfiler {
+   public:
+    enum class Stage {
+        POLL,
+        DECODE,         // payload copy and Cap'n Proto validation
+        APPEND,         // field-at-a-time column append
+        ANONYMIZE,
+        NORMALIZE_URL,
+        SORT,
+        EXPORT,         // block building, gathering and re-encoding
+        INSERT,         // the write to ClickHouse, a file or Kafka
+        COUNT
+    };
+
+    // counters at a point in time, or their difference
+    struct Sample {
+        int64_t  nanos        = 0;
+        uint64_t cycles       = 0;
+        uint64_t instructions = 0;
+        uint64_t cache_misses = 0;
+        uint64_t allocations  = 0;
+
+        Sample& operator+=(const Sample& other);
+        Sample& operator-=(const Sample& other);
+    };
+
+    class Scope {
+       public:
+        inline Scope(Stage stage, size_t records = 0)
+            : Scope(stage, nullptr, records) {}
+        // a part of the stage, reported on a row of its own below it; its
+        // cost still adds up to the stage, its calls and records do not
+        inline Scope(Stage stage, const char* part, size_t records)
+            : stage_(stage), part_(part), records_(records),
+              active_(enabled_) {
+            if (active_) begin();
+        }
+        inline ~Scope() {
+            if (active_) end();
+        }
+        Scope(const Scope&)            = delete;
+        Scope& operator=(const Scope&) = delete;
+
+        // for stages that learn their record count on the way, e.g. a poll
+        inline void setRecords(size_t records) { records_ = records; }
+
+       private:
+        Stage       stage_;
+        const char* part_;  // a string literal, e.g. a column name
+        size_t      records_;
+        bool        active_;
+        Sample      start_;
+        Sample      children_;  // nested scopes, not charged to this stage
+        Scope*      parent_ = nullptr;
+
+        void begin();
+        void end();
+    };
+
+    // the append of one column in the generated appendBatch(), which picks
+    // the variant once per batch so that the disabled one is empty
+    template <bool profiled>
+    class ColumnScope {
+       public:
+        inline ColumnScope(const char* column, size_t records)
+            : scope_(Stage::APPEND, column, records) {}
+
+       private:
+        Scope scope_;
+    };
+
+    // before any thread that runs a Scope is started
+    static void        enable();
+    static inline bool isEnabled() { return enabled_; }
+    // the per-stage breakdown since the last report, which starts a new one
+    static void        report(std::ostream& os);
+
+   private:
+    static inline bool enabled_ = false;
+};
+
+template <>
+class StageProfiler::ColumnScope<false> {
+   public:
+    inline ColumnScope(const char* /*column*/, size_t /*records*/) {}
+};
@@ -0,0 +1,61 @@
+#pragma once
+
+#include <clickhouse/client.h>
+
+#include <memory>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "KeyedHash.hpp"
+
+// Shrinks the url column and scrubs personal data out of it. Query
+// parameters on the allowlist are kept as they are, all others are dropped
+// or, with a key, have their value replaced by a keyed hash, so equal values
+// can still be grouped. User info and fragments are always dropped, the host
+// is lowercased and the result is cut to a maximum length:
+//   HTTPS://me:pw@Example.COM/a?id=7&token=s3cr3t#top
+//     -> https://example.com/a?id=7&token=9f2c...  (allowlist: id, hashed)
+//     -> https://example.com/a?id=7                (allowlist: id, dropped)
+//
+// Each URL is scanned once, 16 bytes at a time, straight from the decoded
+// message into the output.
+class UrlNormalization {
+   public:
+    struct Options {
+        std::vector<std::string> query_allowlist;
+        size_t                   max_length = 1024;  // 0 keeps any length
+        // when set, parameters off the allowlist are hashed, not dropped
+        std::unique_ptr<KeyedHash> value_hash;
+    };
+
+    struct Stats {
+        uint64_t rows         = 0;
+        uint64_t input_bytes  = 0;
+        uint64_t output_bytes = 0;
+    };
+
+    explicit UrlNormalization(Options options);
+
+    void transform(std::string_view url, clickhouse::ColumnString& column);
+    void transformBatch(const std::vector<std::string_view>& urls,
+                        clickhouse::ColumnString&            column);
+
+    inline const Stats& getStats() const { return stats_; }
+
+    // comma separated, empty names are ignored
+    static std::vector<std::string> parseAllowlist(std::string_view list);
+
+   private:
+    Options     options_;
+    Stats       stats_;
+    std::string         output_;  // reused, holds one batch
+    std::vector<size_t> ends_;    // end of every url in output_
+
+    // appends the normalized url to output_
+    void normalize(std::string_view url);
+    bool isAllowed(std::string_view name) const;
+};
+
+std::ostream& operator<<(std::ostream& os, const UrlNormalization::Stats& stats);
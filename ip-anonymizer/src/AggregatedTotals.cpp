@@ -0,0 +1,77 @@
+#include "AggregatedTotals.hpp"
+
+#include <functional>
+
+namespace ch = clickhouse;
+
+void AggregatedTotals::Columns::append(const Key& key, const Totals& totals) {
+    resource_id->Append(key.resource_id);
+    response_status->Append(key.response_status);
+    cache_status->Append(key.cache_status);
+    remote_addr->Append(key.remote_addr);
+    total_bytes_sent->Append(totals.bytes_sent);
+    request_count->Append(totals.requests);
+}
+
+ch::Block AggregatedTotals::Columns::exportToBlockShallow() const {
+    ch::Block block;
+    block.AppendColumn("resource_id", resource_id);
+    block.AppendColumn("response_status", response_status);
+    block.AppendColumn("cache_status", cache_status);
+    block.AppendColumn("remote_addr", remote_addr);
+    block.AppendColumn("total_bytes_sent", total_bytes_sent);
+    block.AppendColumn("request_count", request_count);
+    return block;
+}
+
+void AggregatedTotals::Columns::clear() {
+    resource_id->Clear();
+    response_status->Clear();
+    cache_status->Clear();
+    remote_addr->Clear();
+    total_bytes_sent->Clear();
+    request_count->Clear();
+}
+
+size_t AggregatedTotals::KeyHash::operator()(const Key& key) const {
+    size_t hash = std::hash<uint64_t>()(key.resource_id);
+    auto   mix  = [&hash](size_t value) {
+        hash ^= value + 0x9e3779b97f4a7c15ULL + (hash << 6) + (hash >> 2);
+    };
+    mix(key.response_status);
+    mix(std::hash<std::string>()(key.cache_status));
+    mix(std::hash<std::string>()(key.remote_addr));
+    return hash;
+}
+
+AggregatedTotals::Map& AggregatedTotals::partition(size_t index) {
+    if (index >= partitions_.size()) partitions_.resize(index + 1);
+    return partitions_[index];
+}
+
+void AggregatedTotals::add(size_t partition_index, Key key,
+                           uint64_t bytes_sent) {
+    Totals& totals = partition(partition_index)[std::move(key)];
+    totals.bytes_sent += bytes_sent;
+    ++totals.requests;
+    ++records_;
+}
+
+void AggregatedTotals::appendPartition(const AggregatedTotals& from,
+                                       size_t from_partition,
+                                       size_t partition_index) {
+    if (from_partition >= from.partitions_.size()) return;
+    Map& to = partition(partition_index);
+    for (const auto& [key, totals] : from.partitions_[from_partition]) {
+        Totals& merged = to[key];
+        merged.bytes_sent += totals.bytes_sent;
+        merged.requests += totals.requests;
+        records_ += totals.requests;
+    }
+}
+
+void AggregatedTotals::clear() {
+    // the maps keep their buckets for the next buffer
+    for (auto& partition : partitions_) partition.clear();
+    records_ = 0;
+}
@@ -0,0 +1,11 @@
+#include "Anonymization.hpp"
+
+std::string anonymizeIP(std::string_view ip_address) {
+    size_t lastDotPos = ip_address.rfind('.');
+    if (lastDotPos == std::string_view::npos) {
+        return std::string(ip_address);  // Not a valid IP, return as is
+    }
+    std::string result(ip_address.substr(0, lastDotPos));
+    result += ".X";
+    return result;
+}
@@ -0,0 +1,154 @@
+#include "BufferSorter.hpp"
+
+#include <algorithm>
+#include <chrono>
+#include <numeric>
+#include <ostream>
+
+#include "StageProfiler.hpp"
+
+BufferSorter::BufferSorter() : thread_(&BufferSorter::run, this) {}
+
+BufferSorter::~BufferSorter() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    submitted_.notify_one();
+    thread_.join();
+}
+
+void BufferSorter::submit(ColumnBufferPool::Handle buffer) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        input_.push_back(std::move(buffer));
+    }
+    submitted_.notify_one();
+}
+
+std::vector<ColumnBufferPool::Handle> BufferSorter::collect(bool wait) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (wait) {
+        sorted_.wait(lock, [this] { return input_.empty() && !busy_; });
+    }
+    std::vector<ColumnBufferPool::Handle> sorted(
+        std::make_move_iterator(output_.begin()),
+        std::make_move_iterator(output_.end()));
+    output_.clear();
+    return sorted;
+}
+
+BufferSorter::Stats BufferSorter::getStats() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return stats_;
+}
+
+void BufferSorter::run() {
+    while (true) {
+        ColumnBufferPool::Handle buffer;
+        {
+            std::unique_lock<std::mutex> lock(mutex_);
+            submitted_.wait(lock,
+                            [this] { return stopping_ || !input_.empty(); });
+            if (input_.empty()) return;
+            buffer = std::move(input_.front());
+            input_.pop_front();
+            busy_ = true;
+        }
+
+        auto start = std::chrono::steady_clock::now();
+        bool already_sorted;
+        {
+            StageProfiler::Scope scope(StageProfiler::Stage::SORT,
+                                       buffer->getRowCount());
+            already_sorted = !order_.compute(*buffer->getColumns().timestamp);
+            if (!already_sorted)
+                buffer->permute(order_.get(), columns_scratch_);
+        }
+        auto elapsed = std::chrono::duration_cast<std::chrono::microseconds>(
+            std::chrono::steady_clock::now() - start);
+
+        {
+            std::lock_guard<std::mutex> lock(mutex_);
+            ++stats_.buffers;
+            stats_.already_sorted += already_sorted;
+            stats_.rows += buffer->getRowCount();
+            stats_.sort_us += static_cast<uint64_t>(elapsed.count());
+            output_.push_back(std::move(buffer));
+            busy_ = false;
+        }
+        sorted_.notify_all();
+    }
+}
+
+bool BufferSorter::TimestampOrder::sort(HttpLogRecordColumns& columns,
+                                        HttpLogRecordColumns& scratch) {
+    if (!compute(*columns.timestamp)) return false;
+    scratch.clear();
+    scratch.appendRows(columns, order_);
+    columns.swapColumns(scratch);
+    scratch.clear();
+    return true;
+}
+
+bool BufferSorter::TimestampOrder::compute(
+    const clickhouse::ColumnDateTime& timestamps) {
+    const size_t rows = timestamps.Size();
+    if (rows < 2) return false;
+
+    std::time_t min_time = timestamps.At(0);
+    std::time_t max_time = timestamps.At(0);
+    bool        in_order = true;
+    std::time_t previous = timestamps.At(0);
+    for (size_t row = 1; row < rows; ++row) {
+        std::time_t time = timestamps.At(row);
+        min_time         = std::min(min_time, time);
+        max_time         = std::max(max_time, time);
+        in_order         = in_order && previous <= time;
+        previous         = time;
+    }
+    if (in_order) return false;
+
+    keys_.resize(rows);
+    keys_scratch_.resize(rows);
+    order_.resize(rows);
+    order_scratch_.resize(rows);
+    for (size_t row = 0; row < rows; ++row) {
+        keys_[row] = static_cast<uint64_t>(timestamps.At(row)) -
+                     static_cast<uint64_t>(min_time);
+    }
+    std::iota(order_.begin(), order_.end(), 0);
+
+    const uint64_t range = static_cast<uint64_t>(max_time) -
+                           static_cast<uint64_t>(min_time);
+    for (unsigned shift = 0; shift < 64 && (range >> shift) != 0;
+         shift += 8) {
+        size_t counts[256] = {};
+        for (uint64_t key : keys_) ++counts[(key >> shift) & 0xff];
+        // a byte equal in every key leaves the order as it is
+        if (counts[(keys_[0] >> shift) & 0xff] == rows) continue;
+
+        size_t offset = 0;
+        for (size_t& count : counts) {
+            size_t bucket = count;
+            count         = offset;
+            offset += bucket;
+        }
+        // stable scatter, so earlier passes' order holds within a bucket
+        for (size_t i = 0; i < rows; ++i) {
+            size_t position          = counts[(keys_[i] >> shift) & 0xff]++;
+            keys_scratch_[position]  = keys_[i];
+            order_scratch_[position] = order_[i];
+        }
+        keys_.swap(keys_scratch_);
+        order_.swap(order_scratch_);
+    }
+    return true;
+}
+
+std::ostream& operator<<(std::ostream& os, const BufferSorter::Stats& stats) {
+    return os << "sorted buffers: " << stats.buffers << " ("
+              << stats.already_sorted << " already in order), "
+              << (stats.rows ? 1000.0 * stats.sort_us / stats.rows : 0.0)
+              << " ns per row";
+}
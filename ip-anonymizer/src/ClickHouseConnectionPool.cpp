@@ -0,0 +1,46 @@
+#include "ClickHouseConnectionPool.hpp"
+
+ClickHouseConnectionPool::ClickHouseConnectionPool(
+    std::vector<clickhouse::ClientOptions> endpoints, ConnectHook on_connect)
+    : endpoints_(std::move(endpoints)),
+      on_connect_(std::move(on_connect)),
+      idle_(endpoints_.size()),
+      hooked_(endpoints_.size(), false) {}
+
+std::unique_ptr<clickhouse::Client> ClickHouseConnectionPool::acquire(
+    size_t endpoint) {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        auto&                       idle = idle_[endpoint];
+        if (!idle.empty()) {
+            auto client = std::move(idle.back());
+            idle.pop_back();
+            return client;
+        }
+    }
+    // connecting happens outside the lock, other endpoints stay available
+    auto client = std::make_unique<clickhouse::Client>(endpoints_[endpoint]);
+    bool hooked;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        hooked = hooked_[endpoint];
+    }
+    if (!hooked && on_connect_) {
+        on_connect_(*client);
+        std::lock_guard<std::mutex> lock(mutex_);
+        hooked_[endpoint] = true;
+    }
+    return client;
+}
+
+void ClickHouseConnectionPool::invalidate(size_t endpoint) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    idle_[endpoint].clear();
+    hooked_[endpoint] = false;
+}
+
+void ClickHouseConnectionPool::release(
+    size_t endpoint, std::unique_ptr<clickhouse::Client> client) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    idle_[endpoint].push_back(std::move(client));
+}
@@ -0,0 +1,234 @@
+#include "ClickHouseSink.hpp"
+
+#include <chrono>
+#include <iostream>
+#include <numeric>
+#include <set>
+#include <string>
+#include <vector>
+
+#include "AggregatedTotals.hpp"
+#include "StageProfiler.hpp"
+
+namespace ch = clickhouse;
+
+const std::string AGGREGATED_VIEW_NAME = AggregatedTotals::TABLE_NAME;
+// tables created before rows were sampled lack the weight column
+const std::string SAMPLE_WEIGHT_COLUMN = "sample_weight";
+const std::string ADD_SAMPLE_WEIGHT_DDL =
+    "ALTER TABLE " + std::string(HttpLogRecordColumns::TABLE_NAME) +
+    " ADD COLUMN IF NOT EXISTS sample_weight UInt32 DEFAULT 1";
+
+ClickHouseSink::ClickHouseSink(const clickhouse::ClientOptions& options,
+                               SinkPolicy                       policy,
+                               std::chrono::seconds storage_report_interval,
+                               bool                 presorted)
+    : Sink("clickhouse", policy),
+      options_(options),
+      storage_report_interval_(storage_report_interval),
+      presorted_(presorted) {}
+
+void ClickHouseSink::prepare() {
+    std::cout << "Connecting to ClickHouse, options: " << options_
+              << std::endl;
+    auto client = std::make_unique<ch::Client>(options_);
+    ensureTables(*client);
+    ch_client_ = std::move(client);
+}
+
+void ClickHouseSink::ensureTables(clickhouse::Client& client) {
+    // after a restart of either side the tables are usually there already,
+    // one lookup instead of the DDL round trips
+    const std::string     table = HttpLogRecordColumns::TABLE_NAME;
+    std::set<std::string> existing;
+    client.Select("SELECT name FROM system.tables "
+                  "WHERE database = currentDatabase() AND name IN ('" +
+                      table + "', '" + AGGREGATED_VIEW_NAME +
+                      "') "
+                      "UNION ALL "
+                      "SELECT concat(table, '.', name) FROM system.columns "
+                      "WHERE database = currentDatabase() AND table = '" +
+                      table + "' AND name = '" + SAMPLE_WEIGHT_COLUMN + "'",
+                  [&existing](const ch::Block& block) {
+                      if (block.GetColumnCount() == 0) return;
+                      auto names = block[0]->As<ch::ColumnString>();
+                      for (size_t i = 0; i < block.GetRowCount(); ++i) {
+                          existing.emplace(names->At(i));
+                      }
+                  });
+
+    // create a table if it doesn't exist
+    if (!existing.count(table))
+        client.Execute(HttpLogRecordColumns::CREATE_TABLE_DDL);
+    else if (!existing.count(table + "." + SAMPLE_WEIGHT_COLUMN))
+        client.Execute(ADD_SAMPLE_WEIGHT_DDL);
+
+    // create a materialized view if it doesn't exist
+    if (existing.count(AGGREGATED_VIEW_NAME)) return;
+    client.Execute(
+        "CREATE MATERIALIZED VIEW IF NOT EXISTS http_log_aggregated "
+        "ENGINE = SummingMergeTree() "
+        "ORDER BY (resource_id, response_status, cache_status, remote_addr) "
+        "AS "
+        "SELECT "
+        "    resource_id, "
+        "    response_status, "
+        "    cache_status, "
+        "    remote_addr,"
+        "    sum(bytes_sent) as total_bytes_sent,"
+        "    count() as request_count "
+        "FROM http_logs "
+        "GROUP BY resource_id, response_status, cache_status, remote_addr");
+}
+
+void ClickHouseSink::write(std::deque<SealedBuffer>& queue) {
+    // totals whose rows were stored by an earlier flush
+    insertTotals();
+
+    ch::Block block;
+    {
+        StageProfiler::Scope scope(StageProfiler::Stage::EXPORT);
+        block = queue.front()->exportToBlockShallow();
+
+        // only a backlog, e.g. after an outage, needs the buffers merged,
+        // the usual single buffer is inserted without copying. Sorted
+        // buffers are sorted again as a whole, one after the other they are
+        // only sorted runs.
+        if (queue.size() > 1 && presorted_) {
+            HttpLogRecordColumns         merged;
+            HttpLogRecordColumns         scratch;
+            BufferSorter::TimestampOrder order;
+            std::vector<uint32_t>        rows;
+            for (const auto& buffer : queue) {
+                rows.resize(buffer->getRowCount());
+                std::iota(rows.begin(), rows.end(), 0);
+                merged.appendRows(buffer->getColumns(), rows);
+            }
+            order.sort(merged, scratch);
+            block = merged.exportToBlockShallow();
+        } else if (queue.size() > 1) {
+            ch::Block merged;
+            for (size_t i = 0; i < block.GetColumnCount(); ++i) {
+                ch::ColumnRef column = block[i]->CloneEmpty();
+                for (const auto& buffer : queue) {
+                    column->Append(buffer->exportToBlockShallow()[i]);
+                }
+                merged.AppendColumn(block.GetColumnName(i), column);
+            }
+            block = std::move(merged);
+        }
+        scope.setRecords(block.GetRowCount());
+    }
+
+    auto start = std::chrono::steady_clock::now();
+    try {
+        StageProfiler::Scope scope(StageProfiler::Stage::INSERT,
+                                   block.GetRowCount());
+        // every record of a fully shed buffer is in the totals
+        if (block.GetRowCount() > 0)
+            ch_client_->Insert(HttpLogRecordColumns::TABLE_NAME, block);
+    } catch (...) {
+        dropConnection();
+        throw;
+    }
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start);
+    std::cout << "Insert successful, " << block.GetRowCount() << " rows from "
+              << queue.size() << " buffers in " << elapsed.count() << " ms"
+              << std::endl;
+
+    // the shed totals only go in once their rows are stored, and leave the
+    // queue along with them: a buffer dropped on a rebalance never has its
+    // totals stored, and totals that fail now go first in the next flush
+    for (const auto& buffer : queue) {
+        buffer->getShedTotals().appendTo(pending_totals_);
+    }
+    queue.clear();
+    try {
+        insertTotals();
+    } catch (const std::exception& e) {
+        std::cerr << "Failed to insert shed totals, retried with the next "
+                     "flush: "
+                  << e.what() << std::endl;
+    }
+
+    // the insert is done, a failing report must not make it look failed
+    auto now = std::chrono::steady_clock::now();
+    if (storage_report_interval_.count() > 0 &&
+        now >= next_storage_report_time_) {
+        next_storage_report_time_ = now + storage_report_interval_;
+        try {
+            reportStorage();
+        } catch (const std::exception& e) {
+            std::cerr << "Failed to query storage size: " << e.what()
+                      << std::endl;
+        }
+    }
+}
+
+void ClickHouseSink::dropConnection() {
+    // e.g. a restarted server, the tables are checked again along with
+    // reconnecting
+    ch_client_.reset();
+    reconnect();
+}
+
+void ClickHouseSink::insertTotals() {
+    if (pending_totals_.size() == 0) return;
+    try {
+        StageProfiler::Scope scope(StageProfiler::Stage::INSERT,
+                                   pending_totals_.size());
+        ch_client_->Insert(AggregatedTotals::TABLE_NAME,
+                           pending_totals_.exportToBlockShallow());
+    } catch (...) {
+        dropConnection();
+        throw;
+    }
+    pending_totals_.clear();
+}
+
+void ClickHouseSink::reportStorage() {
+    ch_client_->Select(
+        "SELECT sumIf(rows, column = 'url'), "
+        "    sum(column_data_compressed_bytes), "
+        "    sumIf(column_data_compressed_bytes, column = 'url'), "
+        "    sumIf(column_data_uncompressed_bytes, column = 'url') "
+        "FROM system.parts_columns "
+        "WHERE active AND database = currentDatabase() "
+        "    AND table = '" +
+            std::string(HttpLogRecordColumns::TABLE_NAME) + "'",
+        [](const ch::Block& block) {
+            if (block.GetRowCount() == 0) return;
+            uint64_t rows = block[0]->As<ch::ColumnUInt64>()->At(0);
+            if (rows == 0) return;
+            auto per_row = [rows](const ch::Block& block, size_t column) {
+                return static_cast<double>(
+                           block[column]->As<ch::ColumnUInt64>()->At(0)) /
+                       rows;
+            };
+            std::cout << "Stored " << rows
+                      << " rows, bytes per row on disk: " << per_row(block, 1)
+                      << ", url: " << per_row(block, 2) << " ("
+                      << per_row(block, 3) << " uncompressed)" << std::endl;
+        });
+
+    // server-side cost of the inserts and of merging their parts, needs
+    // the part_log enabled in the server config
+    ch_client_->Select(
+        "SELECT countIf(event_type = 'NewPart'), "
+        "    sumIf(duration_ms, event_type = 'NewPart'), "
+        "    countIf(event_type = 'MergeParts'), "
+        "    sumIf(duration_ms, event_type = 'MergeParts') "
+        "FROM system.part_log "
+        "WHERE database = currentDatabase() AND table = '" +
+            std::string(HttpLogRecordColumns::TABLE_NAME) + "'",
+        [](const ch::Block& block) {
+            if (block.GetRowCount() == 0) return;
+            auto value = [&block](size_t column) {
+                return block[column]->As<ch::ColumnUInt64>()->At(0);
+            };
+            std::cout << "Server inserted " << value(0) << " parts in "
+                      << value(1) << " ms, merged " << value(2) << " in "
+                      << value(3) << " ms" << std::endl;
+        });
+}
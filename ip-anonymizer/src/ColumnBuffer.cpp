@@ -0,0 +1,220 @@
+#include "ColumnBuffer.hpp"
+
+#include <capnp/serialize.h>
+#include <kj/exception.h>
+
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+
+#include "LoadShedder.hpp"
+#include "StageProfiler.hpp"
+
+ch::Block ColumnBuffer::exportToBlockShallow() const {
+    return columns_.exportToBlockShallow();
+}
+
+size_t ColumnBuffer::appendBatch(const std::vector<cppkafka::Message>& messages,
+                                 uint32_t sample_factor) {
+    auto words_for = [](size_t bytes) {
+        return (bytes + sizeof(capnp::word) - 1) / sizeof(capnp::word);
+    };
+
+    // Kafka gives no alignment guarantees, so all payloads are copied into
+    // one word-aligned arena and decoded in place from there
+    size_t total_words = 0;
+    for (const auto& message : messages) {
+        total_words += words_for(message.get_payload().get_size());
+    }
+    StageProfiler::Scope decode(StageProfiler::Stage::DECODE, messages.size());
+    batch_arena_.resize(total_words);
+    batch_readers_.clear();
+    batch_records_.clear();
+    batch_shed_records_.clear();
+    batch_shed_partitions_.clear();
+
+    const int64_t consume_us = nowEpochMicros();
+    size_t        skipped    = 0;
+    size_t        offset     = 0;
+    for (const auto& message : messages) {
+        // skipped messages are consumed too, their offsets advance as well
+        const size_t            partition = trackOffset(message);
+        const cppkafka::Buffer& payload   = message.get_payload();
+        const size_t            words     = words_for(payload.get_size());
+        capnp::word*            begin     = batch_arena_.data() + offset;
+        offset += words;
+        if (words == 0) {
+            ++skipped;
+            continue;
+        }
+        begin[words - 1] = {};  // zero the padding of a truncated last word
+        std::memcpy(begin, payload.get_data(), payload.get_size());
+
+        try {
+            auto& reader = batch_readers_.emplace_back(
+                kj::arrayPtr(static_cast<const capnp::word*>(begin), words));
+            HttpLogRecord::Reader record = reader.getRoot<HttpLogRecord>();
+            // reads every field the columns are filled from, so that a
+            // malformed record throws here and not half-way through the
+            // columns, which would leave them of different lengths
+            HttpLogRecordColumns::validate(record);
+            if (LoadShedder::keep(message.get_partition(),
+                                  message.get_offset(), sample_factor)) {
+                batch_records_.push_back(record);
+                partition_of_row_.push_back(static_cast<uint16_t>(partition));
+            } else {
+                batch_shed_records_.push_back(record);
+                batch_shed_partitions_.push_back(
+                    static_cast<uint16_t>(partition));
+            }
+        } catch (const kj::Exception& e) {
+            ++skipped;
+            std::cerr << "Skipping malformed message: "
+                      << e.getDescription().cStr() << std::endl;
+        }
+    }
+
+    {
+        // appendBatch() adds a row per column below this one
+        StageProfiler::Scope append(StageProfiler::Stage::APPEND,
+                                    batch_records_.size() +
+                                        batch_shed_records_.size());
+        columns_.next_sample_weight = sample_factor;
+        columns_.appendBatch(batch_records_);
+        if (!batch_shed_records_.empty()) countShedRecords();
+    }
+    updateWatermarks(messages, consume_us);
+    return skipped;
+}
+
+void ColumnBuffer::countShedRecords() {
+    // the view is keyed by the anonymized address, like the stored rows
+    shed_addresses_.clear();
+    for (const auto& record : batch_shed_records_) {
+        shed_addresses_.push_back(
+            HttpLogRecordColumns::view(record.getRemoteAddr()));
+    }
+    shed_anonymized_.Clear();
+    anonymization_->transformBatch(shed_addresses_, shed_anonymized_);
+
+    for (size_t i = 0; i < batch_shed_records_.size(); ++i) {
+        const auto& record = batch_shed_records_[i];
+        shed_totals_.add(
+            batch_shed_partitions_[i],
+            {record.getResourceId(), record.getResponseStatus(),
+             std::string(HttpLogRecordColumns::view(record.getCacheStatus())),
+             std::string(shed_anonymized_.At(i))},
+            record.getBytesSent());
+    }
+}
+
+void ColumnBuffer::updateWatermarks(
+    const std::vector<cppkafka::Message>& messages, int64_t consume_us) {
+    BatchWatermarks batch;
+    batch.first_consume_us = consume_us;
+    batch.last_consume_us  = consume_us;
+    for (const auto* records : {&batch_records_, &batch_shed_records_}) {
+        for (const auto& record : *records) {
+            int64_t event_us =
+                static_cast<int64_t>(record.getTimestampEpochMilli()) * 1000;
+            batch.min_event_us = std::min(batch.min_event_us, event_us);
+            batch.max_event_us = std::max(batch.max_event_us, event_us);
+        }
+    }
+    for (const auto& message : messages) {
+        auto timestamp = message.get_timestamp();
+        if (!timestamp) continue;
+        int64_t kafka_us = timestamp->get_timestamp().count() * 1000;
+        batch.min_kafka_us = std::min(batch.min_kafka_us, kafka_us);
+        batch.max_kafka_us = std::max(batch.max_kafka_us, kafka_us);
+    }
+
+    last_batch_watermarks_ = batch;
+    if (batch_records_.empty() && batch_shed_records_.empty()) return;
+    watermarks_.merge(batch);
+}
+
+size_t ColumnBuffer::trackOffset(const cppkafka::Message& message) {
+    // a consumer owns a handful of partitions, a linear search is enough
+    for (size_t i = 0; i < offsets_.size(); ++i) {
+        auto& tracked = offsets_[i];
+        if (tracked.get_partition() == message.get_partition() &&
+            tracked.get_topic() == message.get_topic()) {
+            tracked.set_offset(
+                std::max(tracked.get_offset(), message.get_offset() + 1));
+            return i;
+        }
+    }
+    offsets_.emplace_back(message.get_topic(), message.get_partition(),
+                          message.get_offset() + 1);
+    return offsets_.size() - 1;
+}
+
+void ColumnBuffer::splitPartitions(
+    const cppkafka::TopicPartitionList& partitions, ColumnBuffer& moved,
+    ColumnBuffer& kept) const {
+    std::vector<bool> is_moved(offsets_.size(), false);
+    for (size_t i = 0; i < offsets_.size(); ++i) {
+        for (const auto& partition : partitions) {
+            if (partition.get_partition() == offsets_[i].get_partition() &&
+                partition.get_topic() == offsets_[i].get_topic()) {
+                is_moved[i] = true;
+            }
+        }
+    }
+
+    std::vector<uint32_t> moved_rows;
+    std::vector<uint32_t> kept_rows;
+    for (size_t row = 0; row < partition_of_row_.size(); ++row) {
+        (is_moved[partition_of_row_[row]] ? moved_rows : kept_rows)
+            .push_back(static_cast<uint32_t>(row));
+    }
+
+    std::vector<bool> is_kept(is_moved.size());
+    for (size_t i = 0; i < is_moved.size(); ++i) is_kept[i] = !is_moved[i];
+    moved.appendRows(*this, moved_rows, is_moved);
+    kept.appendRows(*this, kept_rows, is_kept);
+}
+
+void ColumnBuffer::appendRows(const ColumnBuffer&          from,
+                              const std::vector<uint32_t>& rows,
+                              const std::vector<bool>&     partitions) {
+    // partitions of `from` map to new indices in offsets_
+    std::vector<uint16_t> remap(partitions.size(), 0);
+    for (size_t i = 0; i < partitions.size(); ++i) {
+        if (!partitions[i]) continue;
+        remap[i] = static_cast<uint16_t>(offsets_.size());
+        offsets_.push_back(from.offsets_[i]);
+        shed_totals_.appendPartition(from.shed_totals_, i, remap[i]);
+    }
+
+    columns_.appendRows(from.columns_, rows);
+    for (uint32_t row : rows) {
+        partition_of_row_.push_back(remap[from.partition_of_row_[row]]);
+    }
+    // the split halves keep the whole buffer's watermarks, which bound them
+    watermarks_ = from.watermarks_;
+}
+
+void ColumnBuffer::permute(const std::vector<uint32_t>& order,
+                           HttpLogRecordColumns&        scratch) {
+    scratch.clear();
+    scratch.appendRows(columns_, order);
+    columns_.swapColumns(scratch);
+    scratch.clear();
+
+    std::vector<uint16_t> partition_of_row(order.size());
+    for (size_t row = 0; row < order.size(); ++row) {
+        partition_of_row[row] = partition_of_row_[order[row]];
+    }
+    partition_of_row_.swap(partition_of_row);
+}
+
+void ColumnBuffer::clearColumns() {
+    peak_rows_ = getPeakRows();
+    columns_.clear();
+    shed_totals_.clear();
+    watermarks_ = {};
+    offsets_.clear();
+    partition_of_row_.clear();
+}
@@ -0,0 +1,108 @@
+#include "ColumnBufferPool.hpp"
+
+#include <algorithm>
+#include <ostream>
+
+ColumnBufferPool::ColumnBufferPool(
+    size_t preallocated_buffers, size_t reserved_rows,
+    std::shared_ptr<AnonymizationStrategy> anonymization,
+    std::shared_ptr<UrlNormalization>      url_normalization)
+    : state_(std::make_shared<State>()) {
+    state_->stats.reserved_rows = reserved_rows;
+    state_->configured_rows     = reserved_rows;
+    state_->anonymization       = std::move(anonymization);
+    state_->url_normalization   = std::move(url_normalization);
+    for (size_t i = 0; i < preallocated_buffers; ++i) {
+        state_->free_buffers.push_back(makeBuffer(*state_));
+    }
+}
+
+ColumnBufferPool::Handle ColumnBufferPool::acquire() {
+    std::unique_ptr<ColumnBuffer> buffer;
+    {
+        std::lock_guard<std::mutex> lock(state_->mutex);
+        if (state_->free_buffers.empty()) {
+            buffer = makeBuffer(*state_);
+            ++state_->stats.acquired_newly_built;
+        } else {
+            buffer = std::move(state_->free_buffers.back());
+            state_->free_buffers.pop_back();
+            ++state_->stats.acquired_from_pool;
+        }
+        auto& stats = state_->stats;
+        ++stats.buffers_in_use;
+        stats.max_buffers_in_use =
+            std::max(stats.max_buffers_in_use, stats.buffers_in_use);
+    }
+
+    return Handle(buffer.release(),
+                  [state = state_](ColumnBuffer* returned) {
+                      release(state, returned);
+                  });
+}
+
+ColumnBufferPool::Stats ColumnBufferPool::getStats() const {
+    std::lock_guard<std::mutex> lock(state_->mutex);
+    return state_->stats;
+}
+
+// called with the state locked
+std::unique_ptr<ColumnBuffer> ColumnBufferPool::makeBuffer(State& state) {
+    auto buffer = std::make_unique<ColumnBuffer>(state.anonymization,
+                                                 state.url_normalization);
+    buffer->reserve(state.stats.reserved_rows);
+    ++state.stats.buffers_created;
+    return buffer;
+}
+
+void ColumnBufferPool::release(const std::shared_ptr<State>& state,
+                               ColumnBuffer*                 buffer) {
+    std::unique_ptr<ColumnBuffer> owned(buffer);
+    size_t                        rows = owned->getRowCount();
+    owned->clearColumns();
+
+    size_t reserved_rows;
+    {
+        std::lock_guard<std::mutex> lock(state->mutex);
+        auto&                       stats = state->stats;
+        --stats.buffers_in_use;
+        stats.max_rows_per_buffer = std::max(stats.max_rows_per_buffer, rows);
+        // a batch that outgrew the pre-size raises it for all future
+        // buffers right away, it only comes down again at the end of a
+        // window without such batches
+        stats.reserved_rows    = std::max(stats.reserved_rows, rows);
+        state->window_max_rows = std::max(state->window_max_rows, rows);
+        if (++state->window_returns == RESIZE_WINDOW) {
+            stats.reserved_rows =
+                std::max(state->configured_rows, state->window_max_rows);
+            state->window_max_rows = 0;
+            state->window_returns  = 0;
+        }
+        reserved_rows = stats.reserved_rows;
+    }
+
+    // the fixed-width columns keep the capacity of the most rows they held
+    bool replaced = owned->getPeakRows() > 2 * reserved_rows;
+    if (replaced) {
+        owned = std::make_unique<ColumnBuffer>(state->anonymization,
+                                               state->url_normalization);
+    }
+    // a no-op for columns that kept their capacity, restores the ones that
+    // gave it up on Clear()
+    owned->reserve(reserved_rows);
+
+    std::lock_guard<std::mutex> lock(state->mutex);
+    if (replaced) ++state->stats.buffers_created;
+    state->free_buffers.push_back(std::move(owned));
+}
+
+std::ostream& operator<<(std::ostream&                  os,
+                         const ColumnBufferPool::Stats& stats) {
+    return os << "buffers created: " << stats.buffers_created
+              << ", in use: " << stats.buffers_in_use << " (max "
+              << stats.max_buffers_in_use
+              << "), max rows per buffer: " << stats.max_rows_per_buffer
+              << ", reserved rows: " << stats.reserved_rows
+              << ", reused: " << stats.acquired_from_pool
+              << ", newly built: " << stats.acquired_newly_built;
+}
@@ -1,92 +1,166 @@
 #include "IPAnonymizer.hpp"
 
-#include <capnp/message.h>
-#include <capnp/serialize.h>
-#include <clickhouse/client.h>
-
-#include <array>
+#include <algorithm>
+#include <cstdlib>
+#include <fstream>
 #include <iostream>
-#include <sstream>
-#include <variant>
+#include <utility>
 
 #include "ColumnBuffer.hpp"
-#include "ColumnConfiguration.hpp"
-#include "http_log.capnp.h"
-
-namespace ch = clickhouse;
-
-IPAnonymizer::IPAnonymizer(cppkafka::Configuration kafka_consumer_config,
-                           const clickhouse::ClientOptions& clickhouse_config)
-    : IPAnonymizer(
-          std::make_unique<cppkafka::Consumer>(kafka_consumer_config),
-          ClickHouseClientFactory::createClickHouseClient(clickhouse_config)) {
-    if (!ch_client_)
-        throw std::runtime_error("Failed to create ClickHouse client");
+#include "StageProfiler.hpp"
+
+// upper bound of messages decoded together by ColumnBuffer::appendBatch
+const size_t MAX_POLL_BATCH_SIZE = 1000;
+// the buffer being filled plus sealed ones still queued in sinks
+const size_t POOL_PREALLOCATED_BUFFERS = 3;
+// initial pre-size of pooled buffers, grows to the largest buffer seen
+const size_t POOL_RESERVED_ROWS = 16 * 1024;
+// a buffer is handed to the sinks after this long or this many rows
+const std::chrono::seconds SEAL_INTERVAL(60);
+const size_t               SEAL_MAX_ROWS = 1000000;
+// how long a revocation waits for the sinks at most; less with a short
+// max.poll.interval.ms, see revocationTimeout()
+const std::chrono::seconds REVOCATION_FLUSH_TIMEOUT(30);
+// how often --profile prints the per-stage breakdown
+const std::chrono::seconds PROFILE_REPORT_INTERVAL(10);
+
+namespace {
+
+bool samePartition(const cppkafka::TopicPartition& a,
+                   const cppkafka::TopicPartition& b) {
+    return a.get_partition() == b.get_partition() &&
+           a.get_topic() == b.get_topic();
+}
+
+// the revocation callback has to return within the group's rebalance
+// timeout, which is max.poll.interval.ms; the waiting gets half of it, the
+// rest is left for the commit and the handoff
+std::chrono::milliseconds revocationTimeout(
+    const cppkafka::Configuration& config) {
+    std::chrono::milliseconds timeout = REVOCATION_FLUSH_TIMEOUT;
+    try {
+        unsigned long interval = std::strtoul(
+            config.get("max.poll.interval.ms").c_str(), nullptr, 10);
+        if (interval > 0)
+            timeout = std::min(timeout,
+                               std::chrono::milliseconds(interval / 2));
+    } catch (const cppkafka::Exception&) {
+        // not set and no default known, the constant applies
+    }
+    return timeout;
 }
 
-std::string IPAnonymizer::anonymizeIP(const std::string ip_address) {
-    size_t lastDotPos = ip_address.rfind('.');
-    if (lastDotPos == std::string::npos) {
-        return ip_address;  // Not a valid IP, return as is
+}  // namespace
+
+IPAnonymizer::IPAnonymizer(
+    cppkafka::Configuration                kafka_consumer_config,
+    std::vector<std::unique_ptr<Sink>>     sinks,
+    std::shared_ptr<AnonymizationStrategy> anonymization,
+    std::shared_ptr<UrlNormalization>      url_normalization,
+    std::shared_ptr<LatencyTracker>        latency_tracker,
+    std::unique_ptr<BufferSorter>          sorter,
+    std::unique_ptr<LoadShedder>           load_shedder)
+    : consumer_(std::make_unique<cppkafka::Consumer>(kafka_consumer_config)),
+      sinks_(std::move(sinks)),
+      buffer_pool_(POOL_PREALLOCATED_BUFFERS, POOL_RESERVED_ROWS,
+                   std::move(anonymization), url_normalization),
+      url_normalization_(std::move(url_normalization)),
+      latency_tracker_(std::move(latency_tracker)),
+      sorter_(std::move(sorter)),
+      load_shedder_(std::move(load_shedder)),
+      revocation_timeout_(revocationTimeout(kafka_consumer_config)),
+      buffer_(buffer_pool_.acquire()),
+      sinks_ready_(sinks_.size(), false) {
+    for (auto& sink : sinks_) {
+        sink->setLatencyTracker(latency_tracker_);
+    }
+    // both run on the consumer thread, from within poll_batch()
+    consumer_->set_assignment_callback(
+        [this](cppkafka::TopicPartitionList& partitions) {
+            handleAssignment(partitions);
+        });
+    consumer_->set_revocation_callback(
+        [this](const cppkafka::TopicPartitionList& partitions) {
+            handleRevocation(partitions);
+        });
+}
+
+IPAnonymizer::~IPAnonymizer() {
+    for (auto& sink : sinks_) {
+        sink->stop();
     }
-    return ip_address.substr(0, lastDotPos) + ".X";
 }
 
 void IPAnonymizer::consumeAndBufferLogs(const std::string& topic, int timeout) {
-    // create a table if it doesn't exist
-    ch_client_->Execute(
-        "CREATE TABLE IF NOT EXISTS http_logs ("
-        "timestamp DateTime,"
-        "resource_id UInt64,"
-        "bytes_sent UInt64,"
-        "request_time_milli UInt64,"
-        "response_status UInt16,"
-        "cache_status LowCardinality(String),"
-        "method LowCardinality(String),"
-        "remote_addr String,"
-        "url String"
-        ") ENGINE = MergeTree() ORDER BY timestamp");
-
-    // create a materialized view if it doesn't exist
-    ch_client_->Execute(
-        "CREATE MATERIALIZED VIEW IF NOT EXISTS http_log_aggregated "
-        "ENGINE = SummingMergeTree() "
-        "ORDER BY (resource_id, response_status, cache_status, remote_addr) "
-        "AS "
-        "SELECT "
-        "    resource_id, "
-        "    response_status, "
-        "    cache_status, "
-        "    remote_addr,"
-        "    sum(bytes_sent) as total_bytes_sent,"
-        "    count() as request_count "
-        "FROM http_logs "
-        "GROUP BY resource_id, response_status, cache_status, remote_addr");
+    // rows queue up in the sinks until they are ready, backpressure applies
+    for (auto& sink : sinks_) {
+        sink->start();
+    }
 
     consumer_->subscribe({topic});
     consumer_->set_timeout(std::chrono::milliseconds(timeout));
+    latency_tracker_->recordMilestone("subscribed");
 
-    ColumnBuffer buffer(std::move(getFreshColumns()));
-    auto         last_instert_time = std::chrono::system_clock::from_time_t(0);
+    last_seal_time_ = std::chrono::system_clock::now();
+    auto next_profile_time =
+        std::chrono::steady_clock::now() + PROFILE_REPORT_INTERVAL;
 
     while (true) {
-        cppkafka::Message message = consumer_->poll();
+        std::vector<cppkafka::Message> messages;
+        {
+            StageProfiler::Scope poll(StageProfiler::Stage::POLL);
+            messages = consumer_->poll_batch(MAX_POLL_BATCH_SIZE);
+            poll.setRecords(messages.size());
+        }
 
-        if (!message) continue;
-        if (message.get_error()) {
-            handleMessageError(message.get_error());
-            continue;
+        std::erase_if(messages, [this](const cppkafka::Message& message) {
+            if (!message) return true;
+            if (message.get_error()) {
+                handleMessageError(message.get_error());
+                return true;
+            }
+            return false;
+        });
+
+        size_t shed = 0;
+        if (!messages.empty()) {
+            latency_tracker_->recordMilestone("first message");
+            uint32_t sample_factor =
+                load_shedder_ ? load_shedder_->getSampleFactor() : 1;
+            int64_t decode_start_us = nowEpochMicros();
+            size_t  skipped = buffer_->appendBatch(messages, sample_factor);
+            shed            = buffer_->getLastBatchShedCount();
+            latency_tracker_->recordPoll(buffer_->getLastBatchWatermarks(),
+                                         messages.size(), decode_start_us,
+                                         nowEpochMicros());
+            std::cout << "Appended batch of "
+                      << messages.size() - skipped - shed
+                      << " messages to buffer (" << skipped << " skipped, "
+                      << shed << " shed)" << std::endl;
+        }
+        // a paused consumer polls nothing, which is no sign of catching up
+        if (load_shedder_ && !paused_) {
+            load_shedder_->update(messages.empty()
+                                      ? BatchWatermarks{}
+                                      : buffer_->getLastBatchWatermarks(),
+                                  messages.size(), shed);
         }
 
-        std::cout << "Consumed message with payload size: "
-                  << message.get_payload().get_size() << std::endl;
-        buffer.append(message.get_payload());
-        std::cout << "Appended message to buffer. Should insert? "
-                  << shouldInsert(last_instert_time) << std::endl;
+        if (shouldSeal()) {
+            sealBuffer(std::exchange(buffer_, buffer_pool_.acquire()));
+            last_seal_time_ = std::chrono::system_clock::now();
+            latency_tracker_->report(std::cout);
+        }
+        collectSorted(false);
+        updateReadiness();
+        // the sinks write on their own threads, what they stored expired
+        commitStoredOffsets(false);
+        applyBackpressure();
 
-        if (shouldInsert(last_instert_time)) {
-            std::cout << "Attempting insert" << std::endl;
-            attemptInsert(buffer, last_instert_time);
+        if (StageProfiler::isEnabled() &&
+            std::chrono::steady_clock::now() >= next_profile_time) {
+            StageProfiler::report(std::cout);
+            next_profile_time += PROFILE_REPORT_INTERVAL;
         }
     }
 }
@@ -95,24 +169,200 @@ void IPAnonymizer::handleMessageError(const cppkafka::Error& error) {
     std::cerr << "Error while consuming message: " << error << std::endl;
 }
 
-bool IPAnonymizer::shouldInsert(
-    const std::chrono::system_clock::time_point& last_insert_time) const {
-    using namespace std::chrono;
-    auto currentTime = system_clock::now();
-    return duration_cast<seconds>(currentTime - last_insert_time).count() > 60;
+void IPAnonymizer::updateReadiness() {
+    if (ready_) return;
+    bool all_ready = true;
+    for (size_t i = 0; i < sinks_.size(); ++i) {
+        if (!sinks_ready_[i] && sinks_[i]->isReady()) {
+            sinks_ready_[i] = true;
+            latency_tracker_->recordMilestone(sinks_[i]->getName() + " ready");
+        }
+        all_ready = all_ready && sinks_ready_[i];
+    }
+    if (!all_ready) return;
+
+    ready_ = true;
+    latency_tracker_->recordMilestone("ready");
+    if (!ready_file_.empty() && !std::ofstream(ready_file_)) {
+        std::cerr << "Cannot create ready file " << ready_file_ << std::endl;
+    }
+}
+
+bool IPAnonymizer::shouldSeal() const {
+    if (buffer_->empty()) return false;
+    return buffer_->getRowCount() >= SEAL_MAX_ROWS ||
+           std::chrono::system_clock::now() - last_seal_time_ > SEAL_INTERVAL;
 }
 
-void IPAnonymizer::attemptInsert(
-    ColumnBuffer&                          buffer,
-    std::chrono::system_clock::time_point& lastInsertTime) {
-    try {
-        ch_client_->Insert("http_logs", buffer.exportToBlockShallow());
-        buffer.clearColumns();
-        lastInsertTime = std::chrono::system_clock::now();
-        std::cout << "Insert successful" << std::endl;
-    } catch (const std::exception& e) {
-        std::cerr << "Error while inserting to ClickHouse: " << e.what()
+void IPAnonymizer::sealBuffer(ColumnBufferPool::Handle buffer) {
+    // offsets of messages that were all skipped need no sink
+    if (buffer->empty()) {
+        in_flight_.push_back({{}, buffer->getOffsets()});
+        return;
+    }
+
+    buffer->seal();
+    latency_tracker_->recordSeal(buffer->getWatermarks(),
+                                 buffer->getRowCount());
+    // sorting keeps the buffer, so its offsets are tracked in seal order
+    in_flight_.push_back({buffer, buffer->getOffsets()});
+    std::cout << "Sealed buffer of " << buffer->getRowCount()
+              << " rows. Buffer pool: " << buffer_pool_.getStats()
+              << std::endl;
+    std::cout << "Normalized " << url_normalization_->getStats() << std::endl;
+    if (load_shedder_) {
+        std::cout << "Load shedding: " << load_shedder_->getStats()
                   << std::endl;
-        std::this_thread::sleep_for(std::chrono::seconds(1));
+    }
+
+    if (sorter_) {
+        sorter_->submit(std::move(buffer));
+    } else {
+        enqueueSealed(std::move(buffer));
+    }
+}
+
+void IPAnonymizer::enqueueSealed(SealedBuffer buffer) {
+    for (auto& sink : sinks_) {
+        sink->enqueue(buffer);
+    }
+}
+
+void IPAnonymizer::collectSorted(bool wait) {
+    if (!sorter_) return;
+    auto sorted = sorter_->collect(wait);
+    if (sorted.empty()) return;
+    for (auto& buffer : sorted) {
+        enqueueSealed(std::move(buffer));
+    }
+    std::cout << "Presorted " << sorter_->getStats() << std::endl;
+}
+
+void IPAnonymizer::commitStoredOffsets(bool synchronous) {
+    cppkafka::TopicPartitionList offsets;
+    while (!in_flight_.empty() && in_flight_.front().buffer.expired()) {
+        for (const auto& stored : in_flight_.front().offsets) {
+            auto it = std::find_if(offsets.begin(), offsets.end(),
+                                   [&](const cppkafka::TopicPartition& p) {
+                                       return samePartition(p, stored);
+                                   });
+            if (it == offsets.end()) {
+                offsets.push_back(stored);
+            } else {
+                it->set_offset(std::max(it->get_offset(), stored.get_offset()));
+            }
+        }
+        in_flight_.pop_front();
+    }
+
+    // a partition handed over without its rows stored is the new owner's now,
+    // committing it here would move its offset
+    std::erase_if(offsets, [this](const cppkafka::TopicPartition& partition) {
+        return std::none_of(assignment_.begin(), assignment_.end(),
+                            [&](const cppkafka::TopicPartition& assigned) {
+                                return samePartition(assigned, partition);
+                            });
+    });
+    if (offsets.empty()) return;
+
+    try {
+        if (synchronous) {
+            consumer_->commit(offsets);
+        } else {
+            consumer_->async_commit(offsets);
+        }
+    } catch (const cppkafka::HandleException& e) {
+        std::cerr << "Failed to commit offsets: " << e.what() << std::endl;
+    }
+}
+
+void IPAnonymizer::handleAssignment(
+    const cppkafka::TopicPartitionList& partitions) {
+    std::cout << "Assigned partitions: " << partitions << std::endl;
+    latency_tracker_->recordMilestone("assigned");
+    assignment_ = partitions;
+    // pause() only paused the partitions assigned back then, the next
+    // applyBackpressure() pauses the new ones if the sinks are still full
+    paused_ = false;
+}
+
+void IPAnonymizer::handleRevocation(
+    const cppkafka::TopicPartitionList& partitions) {
+    std::cout << "Revoked partitions: " << partitions << std::endl;
+
+    // only the revoked partitions' rows leave the open buffer, the others
+    // keep filling it
+    ColumnBufferPool::Handle revoked = buffer_pool_.acquire();
+    ColumnBufferPool::Handle kept    = buffer_pool_.acquire();
+    buffer_->splitPartitions(partitions, *revoked, *kept);
+    buffer_ = std::move(kept);
+    if (!revoked->getOffsets().empty()) {
+        sealBuffer(std::move(revoked));
+    }
+
+    // sinks write in order, so everything queued before them goes too; the
+    // sinks flush in parallel, each retrying on its own
+    collectSorted(true);
+    // writes still in progress at the deadline are not waited for by
+    // discard() either
+    auto deadline = std::chrono::steady_clock::now() + revocation_timeout_;
+    for (auto& sink : sinks_) {
+        sink->requestFlush();
+    }
+    bool stored = true;
+    for (auto& sink : sinks_) {
+        stored = sink->waitUntilEmpty(deadline) && stored;
+    }
+    commitStoredOffsets(true);
+
+    auto is_revoked = [&partitions](const cppkafka::TopicPartition& partition) {
+        return std::any_of(partitions.begin(), partitions.end(),
+                           [&](const cppkafka::TopicPartition& other) {
+                               return samePartition(other, partition);
+                           });
+    };
+    if (!stored) {
+        // the new owner re-reads the unstored rows from the last commit, so
+        // the sinks drop them. A buffer that also holds partitions that stay
+        // cannot be dropped; that takes cooperative rebalancing, which
+        // cppkafka 0.4 does not do.
+        size_t dropped = 0;
+        for (auto& sink : sinks_) {
+            dropped = std::max(dropped, sink->discard(partitions, deadline));
+        }
+        std::cerr << "Sinks did not store all rows before the handoff, "
+                  << dropped << " queued rows of the revoked partitions were "
+                  << "dropped, the new owner re-reads them" << std::endl;
+    }
+    // the revoked partitions are not committed from here on, even when they
+    // are assigned again: their position is the last commit
+    for (auto& in_flight : in_flight_) {
+        std::erase_if(in_flight.offsets, is_revoked);
+    }
+    std::erase_if(in_flight_, [](const InFlightBuffer& in_flight) {
+        return in_flight.offsets.empty();
+    });
+    std::erase_if(assignment_, is_revoked);
+}
+
+void IPAnonymizer::applyBackpressure() {
+    bool saturated = false;
+    for (const auto& sink : sinks_) {
+        if (sink->isSaturated()) {
+            if (!paused_)
+                std::cout << "Sink " << sink->getName() << " has "
+                          << sink->getQueuedRows()
+                          << " rows queued, pausing consumption" << std::endl;
+            saturated = true;
+        }
+    }
+
+    if (saturated && !paused_) {
+        consumer_->pause();
+        paused_ = true;
+    } else if (!saturated && paused_) {
+        std::cout << "Sinks caught up, resuming consumption" << std::endl;
+        consumer_->resume();
+        paused_ = false;
     }
 }
@@ -0,0 +1,138 @@
+#include "KafkaSink.hpp"
+
+#include <capnp/message.h>
+#include <capnp/serialize.h>
+
+#include <algorithm>
+#include <charconv>
+#include <iostream>
+
+#include "StageProfiler.hpp"
+#include "http_log.capnp.h"
+
+const std::chrono::milliseconds PRODUCER_FLUSH_TIMEOUT(30000);
+const std::chrono::milliseconds PRODUCER_QUEUE_FULL_WAIT(100);
+// the weight of a sampled row, in decimal; the record schema is shared with
+// the producers upstream, so it travels next to the payload
+const std::string SAMPLE_WEIGHT_HEADER = "sample_weight";
+// a record with a url of a few KiB fits, longer ones get a segment of their
+// own from the builder
+const size_t      SEGMENT_WORDS        = 1024;
+
+// the opaque of every message, its buffer's generation and its row
+static_assert(sizeof(void*) >= sizeof(uint64_t));
+
+KafkaSink::KafkaSink(cppkafka::Configuration producer_config,
+                     std::string topic, SinkPolicy policy)
+    : Sink("kafka", policy),
+      topic_(std::move(topic)),
+      deliveries_(std::make_shared<Deliveries>()),
+      segment_(SEGMENT_WORDS) {
+    producer_config.set_delivery_report_callback(
+        [deliveries = deliveries_](cppkafka::Producer&,
+                                   const cppkafka::Message& message) {
+            // a failed message stays undelivered and is produced again
+            if (message.get_error()) return;
+            auto tag = reinterpret_cast<uintptr_t>(message.get_user_data());
+            if ((tag >> 32) != deliveries->generation) return;
+            size_t row = tag & 0xffffffff;
+            if (row < deliveries->delivered.size())
+                deliveries->delivered[row] = 1;
+        });
+    producer_ = std::make_unique<cppkafka::Producer>(producer_config);
+}
+
+void KafkaSink::produce(const cppkafka::MessageBuilder& builder) {
+    while (true) {
+        try {
+            producer_->produce(builder);
+            return;
+        } catch (const cppkafka::HandleException& e) {
+            if (e.get_error().get_error() != RD_KAFKA_RESP_ERR__QUEUE_FULL)
+                throw;
+            // the local queue drains as deliveries are acknowledged
+            producer_->poll(PRODUCER_QUEUE_FULL_WAIT);
+        }
+    }
+}
+
+void KafkaSink::produceRow(const ColumnBuffer& buffer, size_t row) {
+    // a builder cannot be reset, but one over the reused segment allocates
+    // nothing, and zeroes the segment again when it goes
+    capnp::MallocMessageBuilder message(
+        kj::arrayPtr(segment_.data(), segment_.size()));
+    buffer.exportRow(row, message.initRoot<HttpLogRecord>());
+    auto   segments = message.getSegmentsForOutput();
+    size_t words    = capnp::computeSerializedSizeInWords(segments);
+    if (payload_.size() < words) payload_.resize(words);
+    kj::ArrayOutputStream stream(
+        kj::arrayPtr(reinterpret_cast<kj::byte*>(payload_.data()),
+                     words * sizeof(capnp::word)));
+    capnp::writeMessage(stream, segments);
+    auto bytes = stream.getArray();
+
+    char   weight[16];
+    size_t weight_size = static_cast<size_t>(
+        std::to_chars(weight, weight + sizeof(weight),
+                      buffer.getColumns().sample_weight->At(row))
+            .ptr -
+        weight);
+    uint64_t tag = (uint64_t{deliveries_->generation} << 32) | row;
+    // the producer copies payload and headers, both are reused
+    produce(cppkafka::MessageBuilder(topic_)
+                .header(cppkafka::MessageBuilder::HeaderType(
+                    SAMPLE_WEIGHT_HEADER,
+                    cppkafka::Buffer(weight, weight_size)))
+                .payload(cppkafka::Buffer(bytes.begin(), bytes.size()))
+                .user_data(reinterpret_cast<void*>(tag)));
+}
+
+void KafkaSink::write(std::deque<SealedBuffer>& queue) {
+    while (!queue.empty()) {
+        const ColumnBuffer&   buffer    = *queue.front();
+        std::vector<uint8_t>& delivered = deliveries_->delivered;
+        // a retried buffer keeps what was delivered before
+        if (tracked_ != queue.front()) {
+            tracked_ = queue.front();
+            ++deliveries_->generation;
+            delivered.assign(buffer.getRowCount(), 0);
+        }
+
+        {
+            // encoding and handing the rows to the producer, which batches
+            StageProfiler::Scope scope(StageProfiler::Stage::EXPORT);
+            size_t               produced = 0;
+            for (size_t row = 0; row < buffer.getRowCount(); ++row) {
+                if (delivered[row]) continue;
+                produceRow(buffer, row);
+                ++produced;
+            }
+            scope.setRecords(produced);
+        }
+
+        {
+            StageProfiler::Scope scope(StageProfiler::Stage::INSERT,
+                                       buffer.getRowCount());
+            try {
+                producer_->flush(PRODUCER_FLUSH_TIMEOUT);
+            } catch (const cppkafka::HandleException& e) {
+                // what is still in flight is counted as undelivered below
+                if (e.get_error().get_error() != RD_KAFKA_RESP_ERR__TIMED_OUT)
+                    throw;
+            }
+        }
+        size_t undelivered = std::count(delivered.begin(), delivered.end(), 0);
+        if (undelivered > 0) {
+            throw std::runtime_error(
+                std::to_string(undelivered) + " of " +
+                std::to_string(buffer.getRowCount()) +
+                " messages were not delivered to " + topic_ +
+                ", only those are produced again");
+        }
+
+        std::cout << "Published " << buffer.getRowCount() << " rows to "
+                  << topic_ << std::endl;
+        tracked_.reset();
+        queue.pop_front();
+    }
+}
@@ -0,0 +1,169 @@
+#include "KeyedHash.hpp"
+
+#include <openssl/evp.h>
+#include <openssl/hmac.h>
+
+#include <cstring>
+#include <stdexcept>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define KEYED_HASH_X86 1
+#endif
+
+namespace {
+
+// clang-format off
+const uint8_t SBOX[256] = {
+    0x63, 0x7c, 0x77, 0x7b, 0xf2, 0x6b, 0x6f, 0xc5, 0x30, 0x01, 0x67, 0x2b, 0xfe, 0xd7, 0xab, 0x76,
+    0xca, 0x82, 0xc9, 0x7d, 0xfa, 0x59, 0x47, 0xf0, 0xad, 0xd4, 0xa2, 0xaf, 0x9c, 0xa4, 0x72, 0xc0,
+    0xb7, 0xfd, 0x93, 0x26, 0x36, 0x3f, 0xf7, 0xcc, 0x34, 0xa5, 0xe5, 0xf1, 0x71, 0xd8, 0x31, 0x15,
+    0x04, 0xc7, 0x23, 0xc3, 0x18, 0x96, 0x05, 0x9a, 0x07, 0x12, 0x80, 0xe2, 0xeb, 0x27, 0xb2, 0x75,
+    0x09, 0x83, 0x2c, 0x1a, 0x1b, 0x6e, 0x5a, 0xa0, 0x52, 0x3b, 0xd6, 0xb3, 0x29, 0xe3, 0x2f, 0x84,
+    0x53, 0xd1, 0x00, 0xed, 0x20, 0xfc, 0xb1, 0x5b, 0x6a, 0xcb, 0xbe, 0x39, 0x4a, 0x4c, 0x58, 0xcf,
+    0xd0, 0xef, 0xaa, 0xfb, 0x43, 0x4d, 0x33, 0x85, 0x45, 0xf9, 0x02, 0x7f, 0x50, 0x3c, 0x9f, 0xa8,
+    0x51, 0xa3, 0x40, 0x8f, 0x92, 0x9d, 0x38, 0xf5, 0xbc, 0xb6, 0xda, 0x21, 0x10, 0xff, 0xf3, 0xd2,
+    0xcd, 0x0c, 0x13, 0xec, 0x5f, 0x97, 0x44, 0x17, 0xc4, 0xa7, 0x7e, 0x3d, 0x64, 0x5d, 0x19, 0x73,
+    0x60, 0x81, 0x4f, 0xdc, 0x22, 0x2a, 0x90, 0x88, 0x46, 0xee, 0xb8, 0x14, 0xde, 0x5e, 0x0b, 0xdb,
+    0xe0, 0x32, 0x3a, 0x0a, 0x49, 0x06, 0x24, 0x5c, 0xc2, 0xd3, 0xac, 0x62, 0x91, 0x95, 0xe4, 0x79,
+    0xe7, 0xc8, 0x37, 0x6d, 0x8d, 0xd5, 0x4e, 0xa9, 0x6c, 0x56, 0xf4, 0xea, 0x65, 0x7a, 0xae, 0x08,
+    0xba, 0x78, 0x25, 0x2e, 0x1c, 0xa6, 0xb4, 0xc6, 0xe8, 0xdd, 0x74, 0x1f, 0x4b, 0xbd, 0x8b, 0x8a,
+    0x70, 0x3e, 0xb5, 0x66, 0x48, 0x03, 0xf6, 0x0e, 0x61, 0x35, 0x57, 0xb9, 0x86, 0xc1, 0x1d, 0x9e,
+    0xe1, 0xf8, 0x98, 0x11, 0x69, 0xd9, 0x8e, 0x94, 0x9b, 0x1e, 0x87, 0xe9, 0xce, 0x55, 0x28, 0xdf,
+    0x8c, 0xa1, 0x89, 0x0d, 0xbf, 0xe6, 0x42, 0x68, 0x41, 0x99, 0x2d, 0x0f, 0xb0, 0x54, 0xbb, 0x16,
+};
+// clang-format on
+
+const uint8_t RCON[10] = {0x01, 0x02, 0x04, 0x08, 0x10,
+                          0x20, 0x40, 0x80, 0x1b, 0x36};
+
+inline uint8_t xtime(uint8_t x) {
+    return static_cast<uint8_t>((x << 1) ^ ((x & 0x80) ? 0x1b : 0x00));
+}
+
+// FIPS-197 byte-oriented AES-128, used where AES-NI is not available
+void encryptPortable(std::array<uint8_t, 16>&                      state,
+                     const std::array<std::array<uint8_t, 16>, 11>& keys) {
+    auto add_round_key = [&](size_t round) {
+        for (size_t i = 0; i < 16; ++i) state[i] ^= keys[round][i];
+    };
+
+    add_round_key(0);
+    for (size_t round = 1; round <= 10; ++round) {
+        // SubBytes and ShiftRows, the state is column-major
+        std::array<uint8_t, 16> shifted;
+        for (size_t column = 0; column < 4; ++column) {
+            for (size_t row = 0; row < 4; ++row) {
+                shifted[column * 4 + row] =
+                    SBOX[state[((column + row) % 4) * 4 + row]];
+            }
+        }
+        state = shifted;
+
+        if (round != 10) {
+            // MixColumns
+            for (size_t column = 0; column < 4; ++column) {
+                uint8_t* c   = &state[column * 4];
+                uint8_t  all = c[0] ^ c[1] ^ c[2] ^ c[3];
+                uint8_t  c0  = c[0];
+                c[0] ^= all ^ xtime(c[0] ^ c[1]);
+                c[1] ^= all ^ xtime(c[1] ^ c[2]);
+                c[2] ^= all ^ xtime(c[2] ^ c[3]);
+                c[3] ^= all ^ xtime(c[3] ^ c0);
+            }
+        }
+        add_round_key(round);
+    }
+}
+
+#ifdef KEYED_HASH_X86
+__attribute__((target("aes,sse2"))) void encryptAesNi(
+    std::array<uint8_t, 16>&                       block,
+    const std::array<std::array<uint8_t, 16>, 11>& keys) {
+    __m128i state = _mm_loadu_si128(reinterpret_cast<const __m128i*>(&block));
+    state         = _mm_xor_si128(
+        state, _mm_load_si128(reinterpret_cast<const __m128i*>(&keys[0])));
+    for (size_t round = 1; round < 10; ++round) {
+        state = _mm_aesenc_si128(
+            state,
+            _mm_load_si128(reinterpret_cast<const __m128i*>(&keys[round])));
+    }
+    state = _mm_aesenclast_si128(
+        state, _mm_load_si128(reinterpret_cast<const __m128i*>(&keys[10])));
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(&block), state);
+}
+#endif
+
+}  // namespace
+
+KeyedHash::KeyedHash(const Key& key) : use_aesni_(isHardwareAccelerated()) {
+    setKey(key);
+}
+
+bool KeyedHash::isHardwareAccelerated() {
+#ifdef KEYED_HASH_X86
+    return __builtin_cpu_supports("aes");
+#else
+    return false;
+#endif
+}
+
+void KeyedHash::setKey(const Key& key) {
+    // AES-128 key expansion, done once per key so it stays portable
+    round_keys_[0] = key;
+    for (size_t round = 1; round <= 10; ++round) {
+        const Block& previous = round_keys_[round - 1];
+        Block&       current  = round_keys_[round];
+        uint8_t      word[4]  = {SBOX[previous[13]], SBOX[previous[14]],
+                                 SBOX[previous[15]], SBOX[previous[12]]};
+        word[0] ^= RCON[round - 1];
+        for (size_t i = 0; i < 16; ++i) {
+            current[i] = previous[i] ^ (i < 4 ? word[i] : current[i - 4]);
+        }
+    }
+
+    // a short input never has 0xff as its length byte, so the HMAC key is
+    // unrelated to any single-block hash
+    Block derived{};
+    derived[15] = 0xff;
+    encrypt(derived);
+    mac_key_ = derived;
+}
+
+void KeyedHash::encrypt(Block& block) const {
+#ifdef KEYED_HASH_X86
+    if (use_aesni_) {
+        encryptAesNi(block, round_keys_);
+        return;
+    }
+#endif
+    encryptPortable(block, round_keys_);
+}
+
+KeyedHash::Digest KeyedHash::hash128(const void* data, size_t length) const {
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    Block          state{};
+
+    if (length < 16) {
+        // data, zero padding and the length in the last byte
+        std::memcpy(state.data(), bytes, length);
+        state[15] = static_cast<uint8_t>(length);
+        encrypt(state);
+    } else {
+        uint8_t      mac[EVP_MAX_MD_SIZE];
+        unsigned int mac_length = 0;
+        if (!HMAC(EVP_sha256(), mac_key_.data(),
+                  static_cast<int>(mac_key_.size()), bytes, length, mac,
+                  &mac_length)) {
+            throw std::runtime_error("HMAC-SHA256 failed");
+        }
+        std::memcpy(state.data(), mac, state.size());
+    }
+
+    // little-endian words, independent of the host byte order
+    Digest digest{};
+    for (size_t i = 0; i < 16; ++i) {
+        digest[i / 8] |= static_cast<uint64_t>(state[i]) << (8 * (i % 8));
+    }
+    return digest;
+}
@@ -0,0 +1,179 @@
+#include "KeyedPseudonymization.hpp"
+
+#include <cstring>
+
+#include "StageProfiler.hpp"
+
+namespace {
+
+// strict dotted quad, no leading signs, spaces or octets above 255
+bool parseIPv4(std::string_view text, uint32_t& address) {
+    uint32_t result = 0;
+    size_t   pos    = 0;
+    for (int octet = 0; octet < 4; ++octet) {
+        if (octet > 0) {
+            if (pos >= text.size() || text[pos] != '.') return false;
+            ++pos;
+        }
+        uint32_t value  = 0;
+        size_t   digits = 0;
+        while (pos < text.size() && text[pos] >= '0' && text[pos] <= '9' &&
+               digits < 3) {
+            value = value * 10 + static_cast<uint32_t>(text[pos] - '0');
+            ++pos;
+            ++digits;
+        }
+        if (digits == 0 || value > 255) return false;
+        result = (result << 8) | value;
+    }
+    if (pos != text.size()) return false;
+    address = result;
+    return true;
+}
+
+inline char* writeOctet(char* out, uint32_t value) {
+    if (value >= 100) *out++ = static_cast<char>('0' + value / 100);
+    if (value >= 10) *out++ = static_cast<char>('0' + value / 10 % 10);
+    *out++ = static_cast<char>('0' + value % 10);
+    return out;
+}
+
+}  // namespace
+
+KeyedPseudonymization::KeyedPseudonymization(
+    const KeyedHash::Key& secret, std::chrono::seconds rotation_period)
+    : secret_hash_(secret),
+      hash_(secret),
+      rotation_period_(rotation_period),
+      cache_(std::make_unique<CacheSet[]>(CACHE_SETS)) {
+    rotateKeyIfNeeded();
+}
+
+bool KeyedPseudonymization::parseSecret(std::string_view hex,
+                                        KeyedHash::Key&  secret) {
+    if (hex.size() != secret.size() * 2) return false;
+    auto nibble = [](char c) -> int {
+        if (c >= '0' && c <= '9') return c - '0';
+        if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+        if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+        return -1;
+    };
+    for (size_t i = 0; i < secret.size(); ++i) {
+        int high = nibble(hex[2 * i]);
+        int low  = nibble(hex[2 * i + 1]);
+        if (high < 0 || low < 0) return false;
+        secret[i] = static_cast<uint8_t>(high << 4 | low);
+    }
+    return true;
+}
+
+void KeyedPseudonymization::rotateKeyIfNeeded() {
+    using namespace std::chrono;
+    auto     now = system_clock::now().time_since_epoch();
+    uint32_t period =
+        static_cast<uint32_t>(duration_cast<seconds>(now) / rotation_period_) +
+        1;  // keeps 0 free for empty cache entries
+    if (period == period_) return;
+
+    // period key = PRF(secret, period index); the cache invalidates itself
+    // since entries carry the period they were computed in
+    uint8_t period_bytes[4] = {
+        static_cast<uint8_t>(period >> 24), static_cast<uint8_t>(period >> 16),
+        static_cast<uint8_t>(period >> 8), static_cast<uint8_t>(period)};
+    auto digest = secret_hash_.hash128(period_bytes, sizeof(period_bytes));
+    KeyedHash::Key key;
+    for (size_t i = 0; i < key.size(); ++i) {
+        key[i] = static_cast<uint8_t>(digest[i / 8] >> (8 * (i % 8)));
+    }
+    hash_.setKey(key);
+    period_ = period;
+}
+
+void KeyedPseudonymization::transform(std::string_view          address,
+                                      clickhouse::ColumnString& column) {
+    rotateKeyIfNeeded();
+    append(address, column);
+}
+
+void KeyedPseudonymization::transformBatch(
+    const std::vector<std::string_view>& addresses,
+    clickhouse::ColumnString&            column) {
+    StageProfiler::Scope scope(StageProfiler::Stage::ANONYMIZE,
+                               addresses.size());
+    // one clock read per batch, a batch never straddles two keys
+    rotateKeyIfNeeded();
+    for (std::string_view address : addresses) {
+        append(address, column);
+    }
+}
+
+void KeyedPseudonymization::append(std::string_view          address,
+                                   clickhouse::ColumnString& column) {
+    uint32_t ipv4;
+    if (!parseIPv4(address, ipv4)) {
+        static const char HEX[] = "0123456789abcdef";
+        uint64_t          hash  = hash_.hash64(address.data(), address.size());
+        char              text[18] = {'h', ':'};
+        for (size_t i = 0; i < 16; ++i) {
+            text[2 + i] = HEX[(hash >> (60 - 4 * i)) & 0xf];
+        }
+        column.Append(std::string_view(text, sizeof(text)));
+        return;
+    }
+
+    // multiplicative hash of the address picks the set
+    CacheSet&   set = cache_[(ipv4 * 2654435761u) >> 21 & (CACHE_SETS - 1)];
+    CacheEntry* hit = nullptr;
+    if (set.entries[0].period == period_ && set.entries[0].address == ipv4) {
+        hit = &set.entries[0];
+    } else if (set.entries[1].period == period_ &&
+               set.entries[1].address == ipv4) {
+        std::swap(set.entries[0], set.entries[1]);
+        hit = &set.entries[0];
+    }
+
+    if (hit) {
+        ++cache_stats_.hits;
+    } else {
+        ++cache_stats_.misses;
+        set.entries[1] = set.entries[0];
+        hit            = &set.entries[0];
+        hit->address   = ipv4;
+        hit->period    = period_;
+        hit->length =
+            static_cast<uint8_t>(pseudonymizeIPv4(ipv4, hit->text));
+    }
+    column.Append(std::string_view(hit->text, hit->length));
+}
+
+size_t KeyedPseudonymization::pseudonymizeIPv4(uint32_t address,
+                                               char*    out) const {
+    // the round functions of a 4-round Feistel network over the last octet
+    // come from the /24 prefix, which makes the mapping a keyed permutation
+    // of each /24: 16 nibbles per round, indexed by the right half
+    uint8_t input[4] = {static_cast<uint8_t>(address >> 24),
+                        static_cast<uint8_t>(address >> 16),
+                        static_cast<uint8_t>(address >> 8), 0};
+    KeyedHash::Digest first = hash_.hash128(input, sizeof(input));
+    input[3]                = 1;
+    KeyedHash::Digest second = hash_.hash128(input, sizeof(input));
+    const uint64_t    rounds[4] = {first[0], first[1], second[0], second[1]};
+
+    uint32_t left  = (address >> 4) & 0xf;
+    uint32_t right = address & 0xf;
+    for (uint64_t round : rounds) {
+        uint32_t next = left ^ static_cast<uint32_t>(round >> (4 * right) & 0xf);
+        left          = right;
+        right         = next;
+    }
+
+    char* end = out;
+    end       = writeOctet(end, address >> 24);
+    *end++    = '.';
+    end       = writeOctet(end, address >> 16 & 0xff);
+    *end++    = '.';
+    end       = writeOctet(end, address >> 8 & 0xff);
+    *end++    = '.';
+    end       = writeOctet(end, left << 4 | right);
+    return static_cast<size_t>(end - out);
+}
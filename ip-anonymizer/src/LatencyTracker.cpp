@@ -0,0 +1,202 @@
+#include "LatencyTracker.hpp"
+
+#include <algorithm>
+#include <bit>
+#include <chrono>
+#include <cstdio>
+#include <iomanip>
+#include <iostream>
+#include <sstream>
+#include <string>
+
+namespace {
+
+std::string threadNameEvent(const std::string& name, int thread) {
+    return "{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":" +
+           std::to_string(thread) + ",\"args\":{\"name\":\"" + name +
+           "\"}},\n";
+}
+
+}  // namespace
+
+int64_t nowEpochMicros() {
+    using namespace std::chrono;
+    return duration_cast<microseconds>(system_clock::now().time_since_epoch())
+        .count();
+}
+
+void BatchWatermarks::merge(const BatchWatermarks& other) {
+    if (other.empty()) return;
+    min_event_us    = std::min(min_event_us, other.min_event_us);
+    max_event_us    = std::max(max_event_us, other.max_event_us);
+    min_kafka_us    = std::min(min_kafka_us, other.min_kafka_us);
+    max_kafka_us    = std::max(max_kafka_us, other.max_kafka_us);
+    last_consume_us = std::max(last_consume_us, other.last_consume_us);
+    if (empty()) first_consume_us = other.first_consume_us;
+}
+
+void LatencyHistogram::record(int64_t micros) {
+    // a negative span means the clocks of producer and consumer disagree
+    uint64_t value = static_cast<uint64_t>(std::max<int64_t>(micros, 0));
+    size_t   bucket =
+        std::min<size_t>(std::bit_width(value), BUCKETS - 1);  // 0, 1, 2-3, ..
+    ++buckets_[bucket];
+    ++count_;
+    max_ = std::max(max_, static_cast<int64_t>(value));
+}
+
+int64_t LatencyHistogram::percentile(double p) const {
+    if (count_ == 0) return 0;
+    uint64_t rank = static_cast<uint64_t>(p * static_cast<double>(count_));
+    uint64_t seen = 0;
+    for (size_t i = 0; i < BUCKETS; ++i) {
+        seen += buckets_[i];
+        if (seen > rank) {
+            int64_t upper = i == 0 ? 0 : (int64_t{1} << i) - 1;
+            return std::min(upper, max_);
+        }
+    }
+    return max_;
+}
+
+LatencyTracker::LatencyTracker(const std::string& trace_path,
+                               size_t             max_trace_bytes)
+    : created_us_(nowEpochMicros()),
+      trace_path_(trace_path),
+      max_trace_bytes_(max_trace_bytes) {
+    if (!trace_path_.empty()) openTrace();
+}
+
+void LatencyTracker::recordPoll(const BatchWatermarks& batch, size_t messages,
+                                int64_t decode_start_us,
+                                int64_t decode_end_us) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    histograms_["decode"].record(decode_end_us - decode_start_us);
+    if (batch.empty()) return;
+    if (batch.min_kafka_us != BatchWatermarks::UNSET_MIN)
+        histograms_["kafka->consume"].record(batch.first_consume_us -
+                                             batch.min_kafka_us);
+    if (batch.min_event_us != BatchWatermarks::UNSET_MIN)
+        histograms_["event->consume"].record(batch.first_consume_us -
+                                             batch.min_event_us);
+    traceEvent("decode", traceThread("consumer"), decode_start_us,
+               decode_end_us, messages);
+}
+
+void LatencyTracker::recordSeal(const BatchWatermarks& buffer, size_t rows) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    histograms_["consume->seal"].record(buffer.seal_us -
+                                        buffer.first_consume_us);
+    traceEvent("fill buffer", traceThread("consumer"), buffer.first_consume_us,
+               buffer.seal_us, rows);
+}
+
+void LatencyTracker::recordFlush(const std::string&     sink,
+                                 const BatchWatermarks& buffer, size_t rows,
+                                 int64_t flush_start_us, int64_t ack_us) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    histograms_[sink + " seal->flush"].record(flush_start_us - buffer.seal_us);
+    histograms_[sink + " flush->ack"].record(ack_us - flush_start_us);
+    if (buffer.min_event_us != BatchWatermarks::UNSET_MIN)
+        histograms_[sink + " end-to-end"].record(ack_us - buffer.min_event_us);
+
+    int thread = traceThread(sink);
+    traceEvent("queued", thread, buffer.seal_us, flush_start_us, rows);
+    traceEvent("write", thread, flush_start_us, ack_us, rows);
+}
+
+void LatencyTracker::recordMilestone(const std::string& name) {
+    int64_t                     now_us = nowEpochMicros();
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!milestones_.emplace(name, now_us - created_us_).second) return;
+    std::cout << "Startup: " << name << " after "
+              << static_cast<double>(now_us - created_us_) / 1000 << " ms"
+              << std::endl;
+    int thread = traceThread("startup");
+    writeTrace("{\"name\":\"" + name +
+               "\",\"ph\":\"i\",\"s\":\"g\",\"pid\":1,\"tid\":" +
+               std::to_string(thread) + ",\"ts\":" + std::to_string(now_us) +
+               "},\n");
+}
+
+std::optional<int64_t> LatencyTracker::getMilestoneMicros(
+    const std::string& name) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    auto                        it = milestones_.find(name);
+    if (it == milestones_.end()) return std::nullopt;
+    return it->second;
+}
+
+void LatencyTracker::report(std::ostream& os) {
+    // formatted into a local stream, so os keeps its own flags and precision
+    std::ostringstream table;
+    auto ms = [](int64_t micros) { return static_cast<double>(micros) / 1000; };
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        table << std::left << std::setw(28) << "Latency (ms)" << std::right
+              << std::setw(8) << "count" << std::setw(9) << "p50"
+              << std::setw(9) << "p99" << std::setw(9) << "max" << "\n"
+              << std::fixed << std::setprecision(1);
+        for (const auto& [stage, histogram] : histograms_) {
+            table << std::left << std::setw(28) << stage << std::right
+                  << std::setw(8) << histogram.getCount() << std::setw(9)
+                  << ms(histogram.percentile(0.5)) << std::setw(9)
+                  << ms(histogram.percentile(0.99)) << std::setw(9)
+                  << ms(histogram.getMax()) << "\n";
+        }
+        histograms_.clear();
+        // the events since the last report, the file stays readable while
+        // the process is running
+        if (trace_.is_open()) trace_.flush();
+    }
+    os << table.str() << std::flush;
+}
+
+int LatencyTracker::traceThread(const std::string& name) {
+    auto it = trace_threads_.find(name);
+    if (it != trace_threads_.end()) return it->second;
+
+    int thread = static_cast<int>(trace_threads_.size()) + 1;
+    writeTrace(threadNameEvent(name, thread));
+    trace_threads_.emplace(name, thread);
+    return thread;
+}
+
+void LatencyTracker::traceEvent(const std::string& name, int thread,
+                                int64_t start_us, int64_t end_us,
+                                size_t rows) {
+    if (!trace_.is_open()) return;
+    writeTrace("{\"name\":\"" + name + "\",\"ph\":\"X\",\"pid\":1,\"tid\":" +
+               std::to_string(thread) + ",\"ts\":" + std::to_string(start_us) +
+               ",\"dur\":" +
+               std::to_string(std::max<int64_t>(end_us - start_us, 0)) +
+               ",\"args\":{\"rows\":" + std::to_string(rows) + "}},\n");
+}
+
+void LatencyTracker::writeTrace(const std::string& event) {
+    if (!trace_.is_open()) return;
+    if (trace_bytes_ + event.size() > max_trace_bytes_) {
+        trace_.close();
+        std::rename(trace_path_.c_str(), (trace_path_ + ".1").c_str());
+        openTrace();
+        if (!trace_.is_open()) return;
+    }
+    trace_ << event;
+    trace_bytes_ += event.size();
+}
+
+void LatencyTracker::openTrace() {
+    trace_.open(trace_path_, std::ios::trunc);
+    if (!trace_) {
+        std::cerr << "Cannot open trace file " << trace_path_ << std::endl;
+        trace_.close();
+        return;
+    }
+    // JSON array format, the closing bracket is optional for trace viewers
+    std::string header = "[\n";
+    for (const auto& [name, thread] : trace_threads_) {
+        header += threadNameEvent(name, thread);
+    }
+    trace_ << header;
+    trace_bytes_ = header.size();
+}
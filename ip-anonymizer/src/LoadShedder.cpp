@@ -0,0 +1,86 @@
+#include "LoadShedder.hpp"
+
+#include <algorithm>
+#include <iostream>
+
+LoadShedder::LoadShedder(Options                          options,
+                         std::shared_ptr<MetricsExporter> metrics)
+    : options_(options),
+      metrics_(std::move(metrics)),
+      next_adjust_time_(std::chrono::steady_clock::now() +
+                        options_.adjust_interval) {
+    publish();
+}
+
+bool LoadShedder::keep(int32_t partition, int64_t offset, uint32_t factor) {
+    if (factor <= 1) return true;
+    // a 64-bit finalizer, so neighbouring offsets spread evenly
+    uint64_t x = static_cast<uint64_t>(partition) << 48 ^
+                 static_cast<uint64_t>(offset);
+    x ^= x >> 33;
+    x *= 0xff51afd7ed558ccdULL;
+    x ^= x >> 33;
+    x *= 0xc4ceb9fe1a85ec53ULL;
+    x ^= x >> 33;
+    return x % factor == 0;
+}
+
+void LoadShedder::update(const BatchWatermarks& batch, size_t records,
+                         size_t shed) {
+    stats_.records += records;
+    stats_.shed += shed;
+    stats_.lag_us = batch.max_kafka_us == BatchWatermarks::UNSET_MAX
+                        ? 0
+                        : std::max<int64_t>(
+                              nowEpochMicros() - batch.max_kafka_us, 0);
+
+    auto now = std::chrono::steady_clock::now();
+    if (now >= next_adjust_time_) {
+        next_adjust_time_ = now + options_.adjust_interval;
+
+        auto     lag      = std::chrono::microseconds(stats_.lag_us);
+        uint32_t previous = stats_.sample_factor;
+        if (options_.lag_threshold.count() > 0 &&
+            lag > options_.lag_threshold) {
+            stats_.sample_factor =
+                std::min(previous * 2, options_.max_sample_factor);
+        } else if (lag < options_.recovery_lag) {
+            stats_.sample_factor = std::max<uint32_t>(previous / 2, 1);
+        }
+
+        if (stats_.sample_factor != previous) {
+            if (stats_.sample_factor > 1) {
+                std::cout << "Overload: consumer lag " << stats_.lag_us / 1000000
+                          << " s, storing 1 in " << stats_.sample_factor
+                          << " records as rows" << std::endl;
+            } else {
+                std::cout << "Consumer lag recovered to "
+                          << stats_.lag_us / 1000000
+                          << " s, storing every record" << std::endl;
+            }
+        }
+    }
+    publish();
+}
+
+void LoadShedder::publish() {
+    if (!metrics_) return;
+    using Type = MetricsExporter::Type;
+    metrics_->set("ip_anonymizer_consumer_lag_seconds", Type::GAUGE,
+                  "Age of the newest consumed Kafka message",
+                  static_cast<double>(stats_.lag_us) / 1000000);
+    metrics_->set("ip_anonymizer_sampling_rate", Type::GAUGE,
+                  "Fraction of the consumed records stored as raw rows",
+                  1.0 / stats_.sample_factor);
+    metrics_->set("ip_anonymizer_records_consumed_total", Type::COUNTER,
+                  "Records consumed", static_cast<double>(stats_.records));
+    metrics_->set("ip_anonymizer_records_shed_total", Type::COUNTER,
+                  "Records counted into the totals but not stored as rows",
+                  static_cast<double>(stats_.shed));
+}
+
+std::ostream& operator<<(std::ostream& os, const LoadShedder::Stats& stats) {
+    return os << stats.records << " records, " << stats.shed
+              << " shed, lag " << stats.lag_us / 1000 << " ms, storing 1 in "
+              << stats.sample_factor;
+}
@@ -0,0 +1,100 @@
+#include "MetricsExporter.hpp"
+
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <iomanip>
+#include <limits>
+#include <sstream>
+#include <stdexcept>
+
+// how often the server thread checks whether it should stop
+const int ACCEPT_POLL_TIMEOUT_MS = 200;
+// scrapers send a short GET, the rest of a longer request is ignored
+const size_t MAX_REQUEST_BYTES = 4096;
+
+MetricsExporter::MetricsExporter(uint16_t port)
+    : listen_fd_(::socket(AF_INET, SOCK_STREAM, 0)) {
+    if (listen_fd_ < 0)
+        throw std::runtime_error(std::string("socket: ") +
+                                 std::strerror(errno));
+    int reuse = 1;
+    ::setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &reuse, sizeof(reuse));
+
+    sockaddr_in address{};
+    address.sin_family      = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port        = htons(port);
+    if (::bind(listen_fd_, reinterpret_cast<sockaddr*>(&address),
+               sizeof(address)) < 0 ||
+        ::listen(listen_fd_, 16) < 0) {
+        std::string error = std::strerror(errno);
+        ::close(listen_fd_);
+        throw std::runtime_error("Cannot listen on port " +
+                                 std::to_string(port) + ": " + error);
+    }
+    thread_ = std::thread([this] { serve(); });
+}
+
+MetricsExporter::~MetricsExporter() {
+    stopping_ = true;
+    if (thread_.joinable()) thread_.join();
+    ::close(listen_fd_);
+}
+
+void MetricsExporter::set(const std::string& name, Type type,
+                          const std::string& help, double value) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    metrics_[name] = {type, help, value};
+}
+
+std::string MetricsExporter::render() {
+    std::ostringstream body;
+    // every digit, the default 6 turns a counter of 12345678 into 1.23457e+07
+    body << std::setprecision(std::numeric_limits<double>::max_digits10);
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (const auto& [name, metric] : metrics_) {
+        body << "# HELP " << name << " " << metric.help << "\n"
+             << "# TYPE " << name << " "
+             << (metric.type == Type::COUNTER ? "counter" : "gauge") << "\n"
+             << name << " " << metric.value << "\n";
+    }
+    return body.str();
+}
+
+void MetricsExporter::serve() {
+    while (!stopping_) {
+        pollfd listening{listen_fd_, POLLIN, 0};
+        if (::poll(&listening, 1, ACCEPT_POLL_TIMEOUT_MS) <= 0) continue;
+        int client = ::accept(listen_fd_, nullptr, nullptr);
+        if (client < 0) continue;
+
+        // one response per connection, whatever was asked for
+        char request[MAX_REQUEST_BYTES];
+        pollfd readable{client, POLLIN, 0};
+        if (::poll(&readable, 1, ACCEPT_POLL_TIMEOUT_MS) > 0) {
+            (void)::recv(client, request, sizeof(request), 0);
+        }
+
+        std::string body     = render();
+        std::string response = "HTTP/1.1 200 OK\r\n"
+                               "Content-Type: text/plain; version=0.0.4\r\n"
+                               "Content-Length: " +
+                               std::to_string(body.size()) +
+                               "\r\n"
+                               "Connection: close\r\n\r\n" +
+                               body;
+        size_t sent = 0;
+        while (sent < response.size()) {
+            ssize_t written = ::send(client, response.data() + sent,
+                                     response.size() - sent, MSG_NOSIGNAL);
+            if (written <= 0) break;
+            sent += static_cast<size_t>(written);
+        }
+        ::close(client);
+    }
+}
@@ -0,0 +1,98 @@
+#include "NativeFileSink.hpp"
+
+#include <clickhouse/base/wire_format.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+#include <filesystem>
+#include <iostream>
+#include <memory>
+
+#include "StageProfiler.hpp"
+
+namespace ch = clickhouse;
+
+NativeFileSink::NativeFileSink(std::string directory, SinkPolicy policy)
+    : Sink("native-file", policy), directory_(std::move(directory)) {
+    std::filesystem::create_directories(directory_);
+}
+
+std::string NativeFileSink::currentFilePath() const {
+    std::time_t now = std::time(nullptr);
+    std::tm     utc{};
+    gmtime_r(&now, &utc);
+    char name[64];
+    std::strftime(name, sizeof(name), "http_logs-%Y%m%d-%H.native", &utc);
+    return (std::filesystem::path(directory_) / name).string();
+}
+
+void NativeFileSink::write(std::deque<SealedBuffer>& queue) {
+    std::string path = currentFilePath();
+    int         fd   = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd < 0) throw std::runtime_error("Cannot open " + path + ": " +
+                                         std::strerror(errno));
+    // closes the file on every exit, including the throws below
+    std::unique_ptr<int, void (*)(int*)> closer(&fd, [](int* f) { ::close(*f); });
+
+    while (!queue.empty()) {
+        ch::Block block = queue.front()->exportToBlockShallow();
+
+        // Native format block: column and row counts, then name, type and
+        // data of every column
+        {
+            StageProfiler::Scope scope(StageProfiler::Stage::EXPORT,
+                                       block.GetRowCount());
+            serialized_.clear();
+            ch::BufferOutput output(&serialized_);
+            ch::WireFormat::WriteUInt64(output, block.GetColumnCount());
+            ch::WireFormat::WriteUInt64(output, block.GetRowCount());
+            for (size_t i = 0; i < block.GetColumnCount(); ++i) {
+                ch::WireFormat::WriteString(output, block.GetColumnName(i));
+                ch::WireFormat::WriteString(output,
+                                            block[i]->Type()->GetName());
+                block[i]->Save(&output);
+            }
+            output.Flush();
+        }
+
+        StageProfiler::Scope scope(StageProfiler::Stage::INSERT,
+                                   block.GetRowCount());
+        // a block written in part would make the rest of the file unreadable,
+        // so a failed write is cut off again before the retry appends it
+        struct stat before {};
+        if (::fstat(fd, &before) < 0)
+            throw std::runtime_error("Cannot stat " + path + ": " +
+                                     std::strerror(errno));
+        size_t written = 0;
+        while (written < serialized_.size()) {
+            ssize_t result =
+                ::write(fd, serialized_.data() + written,
+                        serialized_.size() - written);
+            if (result < 0 && errno == EINTR) continue;
+            if (result <= 0) {
+                if (result == 0) errno = EIO;
+                break;
+            }
+            written += static_cast<size_t>(result);
+        }
+        // the offsets are committed once the buffer is popped, so it has to
+        // be on disk by then
+        if (written < serialized_.size() || ::fsync(fd) < 0) {
+            std::string error = std::strerror(errno);
+            if (::ftruncate(fd, before.st_size) < 0) {
+                std::cerr << "Cannot truncate " << path
+                          << " after a failed write: " << std::strerror(errno)
+                          << std::endl;
+            }
+            throw std::runtime_error("Cannot write to " + path + ": " + error);
+        }
+
+        std::cout << "Wrote " << block.GetRowCount() << " rows to " << path
+                  << std::endl;
+        queue.pop_front();
+    }
+}
@@ -0,0 +1,350 @@
+#include "ShardedClickHouseSink.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <string>
+
+#include "ClickHouseSink.hpp"
+#include "StageProfiler.hpp"
+
+// how often a shard's worker tries to connect the replicas that are down
+const std::chrono::seconds REPLICA_RECONNECT_DELAY(5);
+
+namespace {
+
+std::vector<clickhouse::ClientOptions> flatten(
+    const ShardedClickHouseSink::Topology& topology) {
+    std::vector<clickhouse::ClientOptions> endpoints;
+    for (const auto& replicas : topology) {
+        endpoints.insert(endpoints.end(), replicas.begin(), replicas.end());
+    }
+    return endpoints;
+}
+
+}  // namespace
+
+ShardedClickHouseSink::ShardedClickHouseSink(const Topology& topology,
+                                             SinkPolicy      policy,
+                                             bool            presorted)
+    : Sink("clickhouse-cluster", policy),
+      pool_(flatten(topology), ClickHouseSink::ensureTables),
+      presorted_(presorted) {
+    size_t endpoint = 0;
+    for (const auto& replicas : topology) {
+        Shard& shard = shards_.emplace_back();
+        for (size_t i = 0; i < replicas.size(); ++i) {
+            shard.replicas.push_back({endpoint++});
+        }
+    }
+    for (size_t s = 0; s < shards_.size(); ++s) {
+        shards_[s].worker = std::thread([this, s] { runShard(s); });
+    }
+}
+
+ShardedClickHouseSink::~ShardedClickHouseSink() {
+    // the writer first, it may be waiting for the workers
+    stop();
+    stopping_workers_ = true;
+    for (auto& shard : shards_) {
+        {
+            std::lock_guard<std::mutex> lock(shard.mutex);
+            shard.changed.notify_all();
+        }
+        shard.worker.join();
+    }
+}
+
+bool ShardedClickHouseSink::parseTopology(
+    std::string_view spec, const clickhouse::ClientOptions& defaults,
+    Topology& topology) {
+    topology.clear();
+    auto split = [](std::string_view& rest, char separator) {
+        size_t           end   = rest.find(separator);
+        std::string_view token = rest.substr(0, end);
+        rest.remove_prefix(end == std::string_view::npos ? rest.size()
+                                                         : end + 1);
+        return token;
+    };
+
+    while (!spec.empty()) {
+        std::string_view shard = split(spec, ';');
+        topology.emplace_back();
+        while (!shard.empty()) {
+            std::string_view replica  = split(shard, ',');
+            bool             has_port = replica.find(':') != replica.npos;
+            std::string_view host     = split(replica, ':');
+            if (host.empty() || (has_port && replica.empty())) return false;
+
+            clickhouse::ClientOptions options = defaults;
+            options.SetHost(std::string(host));
+            if (!replica.empty()) {
+                unsigned long port = 0;
+                for (char c : replica) {
+                    if (c < '0' || c > '9') return false;
+                    port = port * 10 + static_cast<unsigned long>(c - '0');
+                    if (port > 65535) return false;
+                }
+                options.SetPort(static_cast<uint16_t>(port));
+            }
+            topology.back().push_back(std::move(options));
+        }
+        if (topology.back().empty()) return false;
+    }
+    return !topology.empty();
+}
+
+void ShardedClickHouseSink::prepare() {
+    for (size_t s = 0; s < shards_.size(); ++s) {
+        bool ready = false;
+        for (const auto& replica : shards_[s].replicas) {
+            try {
+                pool_.release(replica.endpoint,
+                              pool_.acquire(replica.endpoint));
+                ready = true;
+            } catch (const std::exception& e) {
+                std::cerr << "Failed to prepare "
+                          << pool_.getOptions(replica.endpoint) << ": "
+                          << e.what() << std::endl;
+            }
+        }
+        if (!ready)
+            throw std::runtime_error("No replica of shard " +
+                                     std::to_string(s) + " is reachable");
+    }
+}
+
+void ShardedClickHouseSink::write(std::deque<SealedBuffer>& queue) {
+    // a new flush takes everything queued; a retried one keeps its rows, so
+    // shards that stored them already are not written twice
+    if (pending_buffers_ == 0) {
+        for (const auto& buffer : queue) {
+            partition(*buffer);
+        }
+        // one after the other, sorted buffers are only sorted runs
+        if (presorted_ && queue.size() > 1) {
+            StageProfiler::Scope scope(StageProfiler::Stage::SORT);
+            size_t               rows = 0;
+            for (auto& shard : shards_) {
+                order_.sort(shard.rows, sort_scratch_);
+                rows += shard.rows.size();
+            }
+            scope.setRecords(rows);
+        }
+        for (auto& shard : shards_) {
+            shard.pending = shard.rows.size() > 0 || shard.totals.size() > 0;
+        }
+        pending_buffers_ = queue.size();
+    }
+
+    // parked shards keep their rows until a replica is back, the others
+    // are inserted in parallel by their workers
+    auto                start  = std::chrono::steady_clock::now();
+    size_t              parked = 0;
+    std::vector<size_t> started;
+    for (size_t s = 0; s < shards_.size(); ++s) {
+        Shard& shard = shards_[s];
+        if (!shard.pending) continue;
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        if (shard.parked) {
+            ++parked;
+            continue;
+        }
+        shard.inserting = true;
+        shard.changed.notify_all();
+        started.push_back(s);
+    }
+
+    size_t failed = 0;
+    for (size_t s : started) {
+        Shard&                       shard = shards_[s];
+        std::unique_lock<std::mutex> lock(shard.mutex);
+        shard.changed.wait(lock, [&shard] { return !shard.inserting; });
+        if (!shard.error.empty()) {
+            std::cerr << shard.error << std::endl;
+            ++failed;
+        }
+    }
+    if (failed > 0 || parked > 0) {
+        throw std::runtime_error(
+            std::to_string(failed) + " of " + std::to_string(started.size()) +
+            " shard inserts failed, " + std::to_string(parked) +
+            " shards are down");
+    }
+
+    auto elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now() - start);
+    std::cout << "Insert successful, " << pending_buffers_
+              << " buffers over " << started.size() << " shards in "
+              << elapsed.count() << " ms" << std::endl;
+    queue.erase(queue.begin(), queue.begin() + pending_buffers_);
+    pending_buffers_ = 0;
+}
+
+void ShardedClickHouseSink::discarding(const std::vector<bool>& discarded) {
+    bool pending = false;
+    for (size_t i = 0; i < pending_buffers_; ++i) {
+        pending = pending || discarded[i];
+    }
+    if (!pending) return;
+    // shards that stored the flush already get its remaining buffers again;
+    // with eager rebalancing every buffer is discarded, so there are none.
+    // A shard that stored its rows keeps their totals to store them too.
+    for (auto& shard : shards_) {
+        shard.rows.clear();
+        if (!shard.rows_stored) shard.totals.clear();
+        shard.pending     = shard.totals.size() > 0;
+        shard.rows_stored = false;
+    }
+    pending_buffers_ = 0;
+}
+
+void ShardedClickHouseSink::partition(const ColumnBuffer& buffer) {
+    const HttpLogRecordColumns& columns = buffer.getColumns();
+    size_t                      rows    = columns.size();
+    StageProfiler::Scope        scope(StageProfiler::Stage::EXPORT, rows);
+
+    // shard of every row first, in one tight loop over the key column
+    shard_of_row_.resize(rows);
+    const auto&    resource_id = *columns.resource_id;
+    const uint64_t shard_count = shards_.size();
+    for (size_t row = 0; row < rows; ++row) {
+        shard_of_row_[row] =
+            static_cast<uint32_t>(intHash64(resource_id.At(row)) % shard_count);
+    }
+
+    // then the row indices of every shard, counted first so nothing grows
+    std::vector<size_t> counts(shards_.size(), 0);
+    for (uint32_t shard : shard_of_row_) ++counts[shard];
+    for (size_t s = 0; s < shards_.size(); ++s) {
+        shards_[s].row_indices.clear();
+        shards_[s].row_indices.reserve(counts[s]);
+    }
+    for (size_t row = 0; row < rows; ++row) {
+        shards_[shard_of_row_[row]].row_indices.push_back(
+            static_cast<uint32_t>(row));
+    }
+
+    // and a gather of every column per shard
+    for (auto& shard : shards_) {
+        if (!shard.row_indices.empty()) {
+            shard.rows.appendRows(columns, shard.row_indices);
+        }
+    }
+
+    // totals go with the rows of their resource
+    buffer.getShedTotals().forEach([this, shard_count](
+                                       const AggregatedTotals::Key&    key,
+                                       const AggregatedTotals::Totals& totals) {
+        shards_[intHash64(key.resource_id) % shard_count].totals.append(
+            key, totals);
+    });
+}
+
+void ShardedClickHouseSink::runShard(size_t shard_index) {
+    Shard&                       shard = shards_[shard_index];
+    std::unique_lock<std::mutex> lock(shard.mutex);
+    auto                         any_down = [&shard] {
+        return std::any_of(shard.replicas.begin(), shard.replicas.end(),
+                           [](const Replica& replica) { return !replica.up; });
+    };
+    while (!stopping_workers_) {
+        if (shard.inserting) {
+            lock.unlock();
+            std::string error;
+            try {
+                insertShard(shard_index);
+            } catch (const std::exception& e) {
+                error = e.what();
+            }
+            lock.lock();
+            shard.error     = std::move(error);
+            shard.inserting = false;
+            shard.changed.notify_all();
+        } else if (any_down()) {
+            shard.changed.wait_for(lock, REPLICA_RECONNECT_DELAY, [&] {
+                return stopping_workers_ || shard.inserting;
+            });
+            if (stopping_workers_ || shard.inserting) continue;
+            lock.unlock();
+            reconnectReplicas(shard_index);
+            lock.lock();
+        } else {
+            shard.changed.wait(lock, [&] {
+                return stopping_workers_ || shard.inserting;
+            });
+        }
+    }
+}
+
+void ShardedClickHouseSink::insertShard(size_t shard_index) {
+    Shard&    shard = shards_[shard_index];
+    ch::Block block = shard.rows.exportToBlockShallow();
+
+    // the preferred replica first, the ones that are down are reconnected
+    // in the background instead
+    for (size_t i = 0; i < shard.replicas.size(); ++i) {
+        size_t   index   = (shard.preferred + i) % shard.replicas.size();
+        Replica& replica = shard.replicas[index];
+        if (!replica.up) continue;
+        try {
+            StageProfiler::Scope scope(StageProfiler::Stage::INSERT,
+                                       block.GetRowCount());
+            auto                 client = pool_.acquire(replica.endpoint);
+            // totals only once their rows are stored, a retry after the
+            // totals failed does not send the rows twice
+            if (!shard.rows_stored && block.GetRowCount() > 0) {
+                client->Insert(HttpLogRecordColumns::TABLE_NAME, block);
+                shard.rows_stored = true;
+            }
+            if (shard.totals.size() > 0)
+                client->Insert(AggregatedTotals::TABLE_NAME,
+                               shard.totals.exportToBlockShallow());
+            pool_.release(replica.endpoint, std::move(client));
+        } catch (const std::exception& e) {
+            std::cerr << "Insert into shard " << shard_index << " replica "
+                      << pool_.getOptions(replica.endpoint)
+                      << " failed: " << e.what() << std::endl;
+            replica.up = false;
+            pool_.invalidate(replica.endpoint);
+            continue;
+        }
+
+        shard.preferred   = index;
+        shard.pending     = false;
+        shard.rows_stored = false;
+        shard.rows.clear();
+        shard.totals.clear();
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        shard.parked = true;
+    }
+    throw std::runtime_error("No replica of shard " +
+                             std::to_string(shard_index) +
+                             " accepted the insert, parked until one is up");
+}
+
+void ShardedClickHouseSink::reconnectReplicas(size_t shard_index) {
+    Shard& shard = shards_[shard_index];
+    bool   up    = false;
+    for (auto& replica : shard.replicas) {
+        if (!replica.up) {
+            try {
+                // runs the table check again, the endpoint was invalidated
+                pool_.release(replica.endpoint,
+                              pool_.acquire(replica.endpoint));
+                replica.up = true;
+                std::cout << "Replica " << pool_.getOptions(replica.endpoint)
+                          << " of shard " << shard_index << " is up again"
+                          << std::endl;
+            } catch (const std::exception&) {
+                // tried again after the delay
+            }
+        }
+        up = up || replica.up;
+    }
+    if (!up) return;
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    shard.parked = false;
+}
@@ -0,0 +1,166 @@
+#include "Sink.hpp"
+
+#include <algorithm>
+#include <iostream>
+#include <vector>
+
+void Sink::start() {
+    writer_ = std::thread([this] { run(); });
+}
+
+void Sink::stop() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        stopping_ = true;
+    }
+    changed_.notify_all();
+    if (writer_.joinable()) writer_.join();
+}
+
+void Sink::run() {
+    std::unique_lock<std::mutex> lock(mutex_);
+    if (!warmUp(lock)) return;
+    while (!stopping_) {
+        auto now = std::chrono::steady_clock::now();
+        if (queue_.empty()) {
+            changed_.wait(lock);
+        } else if (now < next_flush_time_) {
+            changed_.wait_until(lock, next_flush_time_);
+        } else {
+            flush(lock);
+            if (!isReady() && !warmUp(lock)) return;
+        }
+    }
+}
+
+bool Sink::warmUp(std::unique_lock<std::mutex>& lock) {
+    while (!stopping_) {
+        lock.unlock();
+        try {
+            prepare();
+            ready_.store(true, std::memory_order_release);
+        } catch (const std::exception& e) {
+            std::cerr << "Sink " << name_ << " not ready: " << e.what()
+                      << std::endl;
+        }
+        lock.lock();
+        if (isReady()) return true;
+        auto delay = std::max(policy_.retry_delay, std::chrono::seconds(1));
+        changed_.wait_for(lock, delay, [this] { return stopping_; });
+    }
+    return false;
+}
+
+void Sink::flush(std::unique_lock<std::mutex>& lock) {
+    // write() pops from the front of its copy, whatever it popped has been
+    // acknowledged; discard() leaves the copied buffers alone meanwhile
+    std::deque<SealedBuffer> batch(queue_.begin(), queue_.end());
+    writing_ = batch.size();
+    lock.unlock();
+
+    auto    now            = std::chrono::steady_clock::now();
+    int64_t flush_start_us = nowEpochMicros();
+    size_t  attempted      = batch.size();
+    bool    written        = false;
+    try {
+        write(batch);
+        written = true;
+    } catch (const std::exception& e) {
+        std::cerr << "Error while writing to sink " << name_ << ": "
+                  << e.what() << std::endl;
+    }
+    int64_t ack_us = nowEpochMicros();
+
+    lock.lock();
+    for (size_t acked = attempted - batch.size(); acked > 0; --acked) {
+        const SealedBuffer& buffer = queue_.front();
+        if (latency_tracker_) {
+            latency_tracker_->recordFlush(name_, buffer->getWatermarks(),
+                                          buffer->getRowCount(),
+                                          flush_start_us, ack_us);
+        }
+        queued_rows_ -= buffer->getRowCount();
+        queue_.pop_front();
+    }
+    writing_ = 0;
+    // a requestFlush() meanwhile may have moved the time forward already
+    auto delay = written ? policy_.flush_interval : policy_.retry_delay;
+    next_flush_time_ = std::max(next_flush_time_, now + delay);
+    changed_.notify_all();
+}
+
+void Sink::enqueue(SealedBuffer buffer) {
+    queued_rows_ += buffer->getRowCount();
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        queue_.push_back(std::move(buffer));
+    }
+    changed_.notify_all();
+}
+
+void Sink::requestFlush() {
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        next_flush_time_ = std::chrono::steady_clock::now();
+    }
+    changed_.notify_all();
+}
+
+bool Sink::waitUntilEmpty(std::chrono::steady_clock::time_point deadline) {
+    std::unique_lock<std::mutex> lock(mutex_);
+    return changed_.wait_until(lock, deadline,
+                               [this] { return queue_.empty(); });
+}
+
+size_t Sink::discard(const cppkafka::TopicPartitionList&   partitions,
+                     std::chrono::steady_clock::time_point deadline) {
+    auto listed = [&partitions](const cppkafka::TopicPartition& partition) {
+        for (const auto& other : partitions) {
+            if (other.get_partition() == partition.get_partition() &&
+                other.get_topic() == partition.get_topic())
+                return true;
+        }
+        return false;
+    };
+
+    std::unique_lock<std::mutex> lock(mutex_);
+    bool idle = changed_.wait_until(lock, deadline,
+                                    [this] { return writing_ == 0; });
+    std::vector<bool> discarded(queue_.size(), false);
+    bool              any          = false;
+    size_t            kept_writing = 0;
+    for (size_t i = 0; i < queue_.size(); ++i) {
+        const auto& offsets = queue_[i]->getOffsets();
+        bool drop = std::all_of(offsets.begin(), offsets.end(), listed);
+        // the buffers of a write in progress may be stored any moment
+        if (drop && i < writing_) {
+            ++kept_writing;
+            continue;
+        }
+        discarded[i] = drop;
+        any          = any || drop;
+    }
+    if (kept_writing > 0) {
+        std::cerr << "Sink " << name_ << " is still writing " << kept_writing
+                  << " buffers of the partitions, their rows may be stored "
+                     "twice"
+                  << std::endl;
+    }
+    if (!any) return 0;
+
+    // a write in progress keeps its state, none of its buffers go
+    if (idle) discarding(discarded);
+    size_t                   rows = 0;
+    std::deque<SealedBuffer> kept;
+    for (size_t i = 0; i < queue_.size(); ++i) {
+        if (discarded[i]) {
+            rows += queue_[i]->getRowCount();
+        } else {
+            kept.push_back(std::move(queue_[i]));
+        }
+    }
+    queue_.swap(kept);
+    queued_rows_ -= rows;
+    changed_.notify_all();
+    return rows;
+}
@@ -0,0 +1,319 @@
+#include "StageProfiler.hpp"
+
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cstdlib>
+#include <cstring>
+#include <iomanip>
+#include <iostream>
+#include <mutex>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+using Stage = StageProfiler::Stage;
+
+const char* const STAGE_NAMES[] = {
+    "poll", "decode", "append", "anonymize",
+    "normalize url", "sort", "export", "insert",
+};
+static_assert(std::size(STAGE_NAMES) == static_cast<size_t>(Stage::COUNT));
+
+// counted by the replaced operator new below once the profiler is enabled,
+// per thread so that counting stays a plain increment
+std::atomic<bool>     counting_allocations = false;
+thread_local uint64_t allocations          = 0;
+
+struct StageStats {
+    uint64_t              calls   = 0;
+    uint64_t              records = 0;
+    StageProfiler::Sample self;
+};
+
+// parts of a stage in the order they first ran, e.g. the columns of append
+struct PartStats {
+    Stage       stage;
+    const char* name;
+    StageStats  stats;
+};
+
+std::mutex mutex;
+std::array<StageStats, static_cast<size_t>(Stage::COUNT)> stats;
+std::vector<PartStats> part_stats;
+std::chrono::steady_clock::time_point report_start;
+std::atomic<bool> counters_available = true;
+
+// one perf event group per thread: cycles leads, instructions and cache
+// misses are scheduled with it and read together in one read(). When the
+// PMU is shared, e.g. with perf or other groups, the group only runs part of
+// the time and the counts are scaled up to the whole time it was enabled.
+class ThreadCounters {
+   public:
+    ThreadCounters() {
+        const uint64_t configs[] = {PERF_COUNT_HW_CPU_CYCLES,
+                                    PERF_COUNT_HW_INSTRUCTIONS,
+                                    PERF_COUNT_HW_CACHE_MISSES};
+        for (size_t i = 0; i < std::size(configs); ++i) {
+            perf_event_attr attr{};
+            attr.size           = sizeof(attr);
+            attr.type           = PERF_TYPE_HARDWARE;
+            attr.config         = configs[i];
+            attr.read_format    = PERF_FORMAT_GROUP |
+                               PERF_FORMAT_TOTAL_TIME_ENABLED |
+                               PERF_FORMAT_TOTAL_TIME_RUNNING;
+            attr.exclude_kernel = 1;
+            attr.exclude_hv     = 1;
+            attr.disabled       = i == 0;
+            fds_[i] = static_cast<int>(::syscall(SYS_perf_event_open, &attr, 0,
+                                                 -1, i == 0 ? -1 : fds_[0], 0));
+            if (fds_[i] < 0) {
+                // e.g. perf_event_paranoid or the container's seccomp profile
+                if (counters_available.exchange(false)) {
+                    std::cerr << "Profiler: perf counters unavailable ("
+                              << std::strerror(errno)
+                              << "), timing and allocations only"
+                              << std::endl;
+                }
+                close();
+                return;
+            }
+        }
+        ::ioctl(fds_[0], PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+    ~ThreadCounters() { close(); }
+
+    inline void read(StageProfiler::Sample& sample) const {
+        if (fds_[0] < 0) return;
+        struct {
+            uint64_t count;
+            uint64_t time_enabled;
+            uint64_t time_running;
+            uint64_t values[3];
+        } group;
+        if (::read(fds_[0], &group, sizeof(group)) != sizeof(group)) return;
+        if (group.time_running == 0) return;
+        double scale = static_cast<double>(group.time_enabled) /
+                       static_cast<double>(group.time_running);
+        auto scaled = [scale](uint64_t value) {
+            return static_cast<uint64_t>(static_cast<double>(value) * scale);
+        };
+        sample.cycles       = scaled(group.values[0]);
+        sample.instructions = scaled(group.values[1]);
+        sample.cache_misses = scaled(group.values[2]);
+    }
+
+   private:
+    int fds_[3] = {-1, -1, -1};
+
+    void close() {
+        for (int& fd : fds_) {
+            if (fd >= 0) ::close(fd);
+            fd = -1;
+        }
+    }
+};
+
+thread_local StageProfiler::Scope* current_scope = nullptr;
+
+inline StageProfiler::Sample now() {
+    static thread_local ThreadCounters counters;
+    StageProfiler::Sample sample;
+    counters.read(sample);
+    sample.allocations = allocations;
+    sample.nanos       = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                       std::chrono::steady_clock::now().time_since_epoch())
+                       .count();
+    return sample;
+}
+
+}  // namespace
+
+// the array forms call these by default, so they are counted as well
+void* operator new(std::size_t size) {
+    if (counting_allocations.load(std::memory_order_relaxed)) ++allocations;
+    if (void* pointer = std::malloc(size ? size : 1)) return pointer;
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment) {
+    if (counting_allocations.load(std::memory_order_relaxed)) ++allocations;
+    // aligned_alloc() wants a multiple of the alignment
+    std::size_t align = static_cast<std::size_t>(alignment);
+    std::size_t bytes = (std::max<std::size_t>(size, 1) + align - 1) / align;
+    if (void* pointer = std::aligned_alloc(align, bytes * align))
+        return pointer;
+    throw std::bad_alloc();
+}
+
+void* operator new(std::size_t size, const std::nothrow_t&) noexcept {
+    try {
+        return operator new(size);
+    } catch (const std::bad_alloc&) {
+        return nullptr;
+    }
+}
+
+void* operator new(std::size_t size, std::align_val_t alignment,
+                   const std::nothrow_t&) noexcept {
+    try {
+        return operator new(size, alignment);
+    } catch (const std::bad_alloc&) {
+        return nullptr;
+    }
+}
+
+void operator delete(void* pointer) noexcept { std::free(pointer); }
+
+void operator delete(void* pointer, std::size_t) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, std::align_val_t) noexcept {
+    std::free(pointer);
+}
+
+void operator delete(void* pointer, std::size_t, std::align_val_t) noexcept {
+    std::free(pointer);
+}
+
+StageProfiler::Sample& StageProfiler::Sample::operator+=(const Sample& other) {
+    nanos += other.nanos;
+    cycles += other.cycles;
+    instructions += other.instructions;
+    cache_misses += other.cache_misses;
+    allocations += other.allocations;
+    return *this;
+}
+
+StageProfiler::Sample& StageProfiler::Sample::operator-=(const Sample& other) {
+    nanos -= other.nanos;
+    cycles -= other.cycles;
+    instructions -= other.instructions;
+    cache_misses -= other.cache_misses;
+    allocations -= other.allocations;
+    return *this;
+}
+
+void StageProfiler::enable() {
+    report_start = std::chrono::steady_clock::now();
+    enabled_     = true;
+    counting_allocations.store(true, std::memory_order_relaxed);
+}
+
+void StageProfiler::Scope::begin() {
+    parent_       = current_scope;
+    current_scope = this;
+    start_        = now();
+}
+
+void StageProfiler::Scope::end() {
+    Sample total = now();
+    total -= start_;
+    Sample self = total;
+    self -= children_;
+    if (parent_) parent_->children_ += total;
+    current_scope = parent_;
+
+    std::lock_guard<std::mutex> lock(mutex);
+    StageStats& stage = stats[static_cast<size_t>(stage_)];
+    stage.self += self;
+    if (!part_) {
+        ++stage.calls;
+        stage.records += records_;
+        return;
+    }
+    // a handful of parts, compared by address since they are literals
+    auto part = std::find_if(part_stats.begin(), part_stats.end(),
+                             [this](const PartStats& other) {
+                                 return other.stage == stage_ &&
+                                        other.name == part_;
+                             });
+    if (part == part_stats.end())
+        part = part_stats.insert(part_stats.end(), {stage_, part_, {}});
+    ++part->stats.calls;
+    part->stats.records += records_;
+    part->stats.self += self;
+}
+
+void StageProfiler::report(std::ostream& os) {
+    std::array<StageStats, static_cast<size_t>(Stage::COUNT)> snapshot;
+    std::vector<PartStats> parts;
+    auto   end = std::chrono::steady_clock::now();
+    double interval_ns;
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        snapshot    = stats;
+        stats       = {};
+        // the parts keep their order, only their numbers start over
+        parts       = part_stats;
+        for (auto& part : part_stats) part.stats = {};
+        interval_ns = static_cast<double>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(end -
+                                                                 report_start)
+                .count());
+        report_start = end;
+    }
+
+    bool counters = counters_available.load();
+    // formatted apart, the caller's stream keeps its precision and flags
+    std::ostringstream table;
+    auto dash = [&table](int width) { table << std::setw(width) << "-"; };
+    auto row  = [&](const std::string& name, const StageStats& stage) {
+        // per call for stages without records, e.g. a poll that got nothing
+        double per = static_cast<double>(
+            stage.records > 0 ? stage.records : stage.calls);
+        table << std::left << std::setw(21) << name << std::right
+              << std::setw(8) << stage.calls << std::setw(10) << stage.records
+              << std::setw(9) << static_cast<double>(stage.self.nanos) / 1e6
+              << std::setw(7)
+              << 100 * static_cast<double>(stage.self.nanos) / interval_ns
+              << std::setw(9) << static_cast<double>(stage.self.nanos) / per;
+        if (counters && stage.self.cycles > 0) {
+            table << std::setw(11)
+                  << static_cast<double>(stage.self.cycles) / per
+                  << std::setw(6) << std::setprecision(2)
+                  << static_cast<double>(stage.self.instructions) /
+                         static_cast<double>(stage.self.cycles)
+                  << std::setprecision(1) << std::setw(11)
+                  << static_cast<double>(stage.self.cache_misses) / per;
+        } else {
+            dash(11);
+            dash(6);
+            dash(11);
+        }
+        table << std::setw(11) << std::setprecision(2)
+              << static_cast<double>(stage.self.allocations) / per
+              << std::setprecision(1) << std::endl;
+    };
+
+    table << "Profile of the last " << std::fixed << std::setprecision(1)
+          << interval_ns / 1e9 << " s" << std::endl;
+    table << std::left << std::setw(21) << "stage" << std::right
+          << std::setw(8) << "calls" << std::setw(10) << "records"
+          << std::setw(9) << "ms" << std::setw(7) << "%" << std::setw(9)
+          << "ns/rec" << std::setw(11) << "cycles/rec" << std::setw(6)
+          << "IPC" << std::setw(11) << "misses/rec" << std::setw(11)
+          << "allocs/rec" << std::endl;
+    for (size_t i = 0; i < snapshot.size(); ++i) {
+        if (snapshot[i].calls == 0) continue;
+        // the stage's own time includes its parts, which follow indented
+        row(STAGE_NAMES[i], snapshot[i]);
+        for (const auto& part : parts) {
+            if (static_cast<size_t>(part.stage) != i || part.stats.calls == 0)
+                continue;
+            row(std::string("  ") + part.name, part.stats);
+        }
+    }
+    os << table.str() << std::flush;
+}
@@ -0,0 +1,204 @@
+#include "UrlNormalization.hpp"
+
+#include <cstring>
+
+#include "StageProfiler.hpp"
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+namespace {
+
+// first byte in [begin, end) equal to any of the needles, or end
+template <char... Needles>
+const char* findAny(const char* begin, const char* end) {
+#ifdef __SSE2__
+    for (; end - begin >= 16; begin += 16) {
+        __m128i chunk =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+        __m128i hits = _mm_setzero_si128();
+        ((hits = _mm_or_si128(hits,
+                              _mm_cmpeq_epi8(chunk, _mm_set1_epi8(Needles)))),
+         ...);
+        int mask = _mm_movemask_epi8(hits);
+        if (mask != 0) return begin + __builtin_ctz(mask);
+    }
+#endif
+    for (; begin != end; ++begin) {
+        if (((*begin == Needles) || ...)) return begin;
+    }
+    return end;
+}
+
+// copies [begin, end) to out with ASCII letters lowercased
+void appendLowercase(std::string& out, const char* begin, const char* end) {
+    size_t offset = out.size();
+    out.resize(offset + static_cast<size_t>(end - begin));
+    char* to = out.data() + offset;
+#ifdef __SSE2__
+    // 'A'..'Z' are the only bytes for which byte - 'A' is below 26 unsigned,
+    // signed compare after flipping the sign bit does the unsigned one
+    const __m128i bias     = _mm_set1_epi8(static_cast<char>('A' + 128));
+    const __m128i limit    = _mm_set1_epi8(static_cast<char>(-128 + 26));
+    const __m128i case_bit = _mm_set1_epi8(0x20);
+    for (; end - begin >= 16; begin += 16, to += 16) {
+        __m128i chunk =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+        __m128i upper = _mm_cmplt_epi8(_mm_sub_epi8(chunk, bias), limit);
+        chunk         = _mm_or_si128(chunk, _mm_and_si128(upper, case_bit));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(to), chunk);
+    }
+#endif
+    for (; begin != end; ++begin, ++to) {
+        char c = *begin;
+        *to    = (c >= 'A' && c <= 'Z') ? static_cast<char>(c | 0x20) : c;
+    }
+}
+
+inline void append(std::string& out, const char* begin, const char* end) {
+    out.append(begin, static_cast<size_t>(end - begin));
+}
+
+}  // namespace
+
+UrlNormalization::UrlNormalization(Options options)
+    : options_(std::move(options)) {}
+
+std::vector<std::string> UrlNormalization::parseAllowlist(
+    std::string_view list) {
+    std::vector<std::string> names;
+    while (!list.empty()) {
+        size_t           comma = list.find(',');
+        std::string_view name  = list.substr(0, comma);
+        if (!name.empty()) names.emplace_back(name);
+        if (comma == std::string_view::npos) break;
+        list.remove_prefix(comma + 1);
+    }
+    return names;
+}
+
+void UrlNormalization::transform(std::string_view          url,
+                                 clickhouse::ColumnString& column) {
+    output_.clear();
+    normalize(url);
+    column.Append(std::string_view(output_));
+}
+
+void UrlNormalization::transformBatch(
+    const std::vector<std::string_view>& urls,
+    clickhouse::ColumnString&            column) {
+    StageProfiler::Scope scope(StageProfiler::Stage::NORMALIZE_URL, urls.size());
+    // the whole batch is normalized into one reused buffer, sized for the
+    // input, only hashed values can make it grow
+    size_t input_size = 0;
+    for (std::string_view url : urls) input_size += url.size();
+    output_.clear();
+    output_.reserve(input_size);
+    ends_.clear();
+    for (std::string_view url : urls) {
+        normalize(url);
+        ends_.push_back(output_.size());
+    }
+
+    size_t begin = 0;
+    for (size_t end : ends_) {
+        column.Append(std::string_view(output_).substr(begin, end - begin));
+        begin = end;
+    }
+}
+
+bool UrlNormalization::isAllowed(std::string_view name) const {
+    for (const auto& allowed : options_.query_allowlist) {
+        if (name == allowed) return true;
+    }
+    return false;
+}
+
+void UrlNormalization::normalize(std::string_view url) {
+    const char* pos   = url.data();
+    const char* end   = pos + url.size();
+    size_t      start = output_.size();
+
+    // scheme and authority: "scheme://user@Host:port", lowercased and
+    // without the user info, or only the authority of a protocol-relative
+    // "//user@Host/path". Origin-form urls ("/path?query") have neither.
+    const char* authority = nullptr;
+    const char* path      = findAny<':', '/', '?', '#'>(pos, end);
+    if (path != end && *path == ':' && end - path >= 3 && path[1] == '/' &&
+        path[2] == '/') {
+        appendLowercase(output_, pos, path + 3);
+        authority = path + 3;
+    } else if (end - pos >= 2 && pos[0] == '/' && pos[1] == '/') {
+        output_ += "//";
+        authority = pos + 2;
+    }
+    if (authority) {
+        path = findAny<'/', '?', '#'>(authority, end);
+        const char* host = authority;
+        for (const char* at = authority; at != path; ++at) {
+            if (*at == '@') host = at + 1;
+        }
+        appendLowercase(output_, host, path);
+    } else {
+        path = pos;
+    }
+
+    // the path is copied as is, in bulk up to the query or fragment
+    const char* query = findAny<'?', '#'>(path, end);
+    append(output_, path, query);
+
+    // query parameters, the fragment is dropped
+    if (query != end && *query == '?') {
+        char        separator = '?';
+        const char* param     = query + 1;
+        while (param < end && *param != '#') {
+            const char* stop     = findAny<'&', '#', '='>(param, end);
+            const char* name_end = stop;
+            if (stop != end && *stop == '=')
+                stop = findAny<'&', '#'>(stop, end);
+            std::string_view name(param,
+                                  static_cast<size_t>(name_end - param));
+
+            if (!name.empty() && isAllowed(name)) {
+                output_ += separator;
+                append(output_, param, stop);
+                separator = '&';
+            } else if (!name.empty() && options_.value_hash) {
+                static const char HEX[] = "0123456789abcdef";
+                output_ += separator;
+                append(output_, param, name_end);
+                if (name_end != stop) {
+                    const char* value = name_end + 1;
+                    uint64_t    hash  = options_.value_hash->hash64(
+                        value, static_cast<size_t>(stop - value));
+                    char text[17] = {'='};
+                    for (size_t i = 0; i < 16; ++i) {
+                        text[1 + i] = HEX[(hash >> (60 - 4 * i)) & 0xf];
+                    }
+                    output_.append(text, sizeof(text));
+                }
+                separator = '&';
+            }
+
+            if (stop == end || *stop == '#') break;
+            param = stop + 1;
+        }
+    }
+
+    if (options_.max_length != 0 &&
+        output_.size() - start > options_.max_length) {
+        output_.resize(start + options_.max_length);
+    }
+
+    ++stats_.rows;
+    stats_.input_bytes += url.size();
+    stats_.output_bytes += output_.size() - start;
+}
+
+std::ostream& operator<<(std::ostream&                  os,
+                         const UrlNormalization::Stats& stats) {
+    double rows = stats.rows ? static_cast<double>(stats.rows) : 1.0;
+    return os << "url bytes per row: " << stats.input_bytes / rows << " -> "
+              << stats.output_bytes / rows;
+}
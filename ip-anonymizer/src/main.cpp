@@ -3,9 +3,17 @@
 #include <cppkafka/consumer.h>
 
 #include <chrono>
+#include <cstdlib>
 #include <iostream>
+#include <string>
 
+#include "ClickHouseSink.hpp"
 #include "IPAnonymizer.hpp"
+#include "KafkaSink.hpp"
+#include "KeyedPseudonymization.hpp"
+#include "NativeFileSink.hpp"
+#include "ShardedClickHouseSink.hpp"
+#include "StageProfiler.hpp"
 #include "http_log.capnp.h"
 
 const std::string       KAFKA_BROKER_LIST     = "broker:29092";
@@ -14,21 +22,189 @@ const std::string       KAFKA_GROUP_ID        = "ip-anonymizer-reader";
 const std::string       CLICKHOUSE_HOST       = "clickhouse-server";
 const uint16_t          CLICKHOUSE_PORT       = 9000;
 const size_t            CONSUMER_POLL_RATE_MS = 1000;
+// prints a per-stage CPU breakdown every 10 seconds
+const std::string       PROFILE_FLAG          = "--profile";
+
+// "host:port,host:port;host:port", shards separated by ';' and replicas by
+// ','; when set, rows are sharded over these nodes instead of CLICKHOUSE_HOST
+const char* const CLICKHOUSE_SHARDS_ENV = "IP_ANONYMIZER_CLICKHOUSE_SHARDS";
+// optional sinks, enabled by setting these environment variables
+const char* const FILE_SINK_DIR_ENV    = "IP_ANONYMIZER_FILE_SINK_DIR";
+const char* const KAFKA_SINK_TOPIC_ENV = "IP_ANONYMIZER_KAFKA_SINK_TOPIC";
+// when set, sealed buffers are sorted by timestamp on a thread of their own
+const char* const PRESORT_ENV          = "IP_ANONYMIZER_PRESORT";
+// seconds between the ClickHouse sink's reports of the bytes per row on disk
+// and of the server's insert and merge times, off by default
+const char* const STORAGE_REPORT_INTERVAL_ENV =
+    "IP_ANONYMIZER_STORAGE_REPORT_INTERVAL";
+// optional Chrome trace file of per-batch stage latencies
+const char* const TRACE_FILE_ENV       = "IP_ANONYMIZER_TRACE_FILE";
+// created once every sink has connected and verified its tables
+const char* const READY_FILE_ENV       = "IP_ANONYMIZER_READY_FILE";
+// consumer lag in seconds above which only a sample of the records is
+// stored as rows, the totals stay exact
+const char* const OVERLOAD_LAG_ENV     = "IP_ANONYMIZER_OVERLOAD_LAG";
+// port of the Prometheus metrics, e.g. consumer lag and sampling rate
+const char* const METRICS_PORT_ENV     = "IP_ANONYMIZER_METRICS_PORT";
+// 32 hex digits; when set, addresses are replaced with keyed pseudonyms
+// instead of having their last octet dropped
+const char* const PSEUDONYM_KEY_ENV    = "IP_ANONYMIZER_PSEUDONYM_KEY";
+const std::chrono::hours PSEUDONYM_ROTATION_PERIOD(24);
+// url normalization: comma separated query parameters kept as they are,
+// "drop" (default) or "hash" for all others, and the maximum url length
+const char* const URL_QUERY_ALLOWLIST_ENV = "IP_ANONYMIZER_URL_QUERY_ALLOWLIST";
+const char* const URL_QUERY_MODE_ENV      = "IP_ANONYMIZER_URL_QUERY_MODE";
+const char* const URL_MAX_LENGTH_ENV      = "IP_ANONYMIZER_URL_MAX_LENGTH";
+
+// the proxy in front of ClickHouse allows one request per minute
+const SinkPolicy CLICKHOUSE_SINK_POLICY{std::chrono::seconds(60),
+                                        std::chrono::seconds(1), 5000000};
+// cluster nodes are reached directly, a part per shard and second at most
+const SinkPolicy CLICKHOUSE_CLUSTER_SINK_POLICY{std::chrono::seconds(1),
+                                                std::chrono::seconds(1),
+                                                5000000};
+const SinkPolicy FILE_SINK_POLICY{std::chrono::seconds(0),
+                                  std::chrono::seconds(10), 5000000};
+const SinkPolicy KAFKA_SINK_POLICY{std::chrono::seconds(0),
+                                   std::chrono::seconds(5), 5000000};
 
 cppkafka::Configuration kafka_config{
     {"metadata.broker.list", KAFKA_BROKER_LIST},
     {"group.id", KAFKA_GROUP_ID},
+    // IPAnonymizer commits once the sinks have stored the rows
+    {"enable.auto.commit", "false"},
 };
 
 clickhouse::ClientOptions clickhouse_config;
 
-int                       main() {
+int                       main(int argc, char** argv) {
+    for (int i = 1; i < argc; ++i) {
+        if (std::string(argv[i]) == PROFILE_FLAG) {
+            StageProfiler::enable();
+        } else {
+            std::cerr << "Unknown argument " << argv[i] << ", usage: "
+                      << argv[0] << " [" << PROFILE_FLAG << "]" << std::endl;
+            return 1;
+        }
+    }
+
     kafka_config.set_default_topic_configuration(
         {{"auto.offset.reset", "smallest"}});
     clickhouse_config.SetHost(CLICKHOUSE_HOST);
     clickhouse_config.SetPort(CLICKHOUSE_PORT);
 
-    IPAnonymizer ipAnonymizer(kafka_config, clickhouse_config);
+    // the ClickHouse sinks sort a merged backlog again
+    const bool presort = std::getenv(PRESORT_ENV) != nullptr;
+
+    std::vector<std::unique_ptr<Sink>> sinks;
+    if (const char* shards = std::getenv(CLICKHOUSE_SHARDS_ENV)) {
+        ShardedClickHouseSink::Topology topology;
+        if (!ShardedClickHouseSink::parseTopology(shards, clickhouse_config,
+                                                  topology)) {
+            std::cerr << "Invalid " << CLICKHOUSE_SHARDS_ENV << ": " << shards
+                      << std::endl;
+            return 1;
+        }
+        sinks.push_back(std::make_unique<ShardedClickHouseSink>(
+            topology, CLICKHOUSE_CLUSTER_SINK_POLICY, presort));
+    } else {
+        std::chrono::seconds storage_report_interval{0};
+        if (const char* interval = std::getenv(STORAGE_REPORT_INTERVAL_ENV)) {
+            storage_report_interval =
+                std::chrono::seconds(std::strtoul(interval, nullptr, 10));
+        }
+        sinks.push_back(std::make_unique<ClickHouseSink>(
+            clickhouse_config, CLICKHOUSE_SINK_POLICY,
+            storage_report_interval, presort));
+    }
+    if (const char* dir = std::getenv(FILE_SINK_DIR_ENV)) {
+        sinks.push_back(std::make_unique<NativeFileSink>(dir, FILE_SINK_POLICY));
+    }
+    if (const char* topic = std::getenv(KAFKA_SINK_TOPIC_ENV)) {
+        cppkafka::Configuration producer_config{
+            {"metadata.broker.list", KAFKA_BROKER_LIST},
+        };
+        sinks.push_back(std::make_unique<KafkaSink>(producer_config, topic,
+                                                    KAFKA_SINK_POLICY));
+    }
+
+    std::shared_ptr<AnonymizationStrategy> anonymization =
+        std::make_shared<LastOctetAnonymization>();
+    const char*    key = std::getenv(PSEUDONYM_KEY_ENV);
+    KeyedHash::Key secret{};
+    if (key) {
+        if (!KeyedPseudonymization::parseSecret(key, secret)) {
+            std::cerr << PSEUDONYM_KEY_ENV << " must be 32 hex digits"
+                      << std::endl;
+            return 1;
+        }
+        anonymization = std::make_shared<KeyedPseudonymization>(
+            secret, PSEUDONYM_ROTATION_PERIOD);
+        std::cout << "Using keyed pseudonyms, AES-NI: "
+                  << KeyedHash::isHardwareAccelerated() << std::endl;
+    }
+
+    UrlNormalization::Options url_options;
+    if (const char* allowlist = std::getenv(URL_QUERY_ALLOWLIST_ENV)) {
+        url_options.query_allowlist =
+            UrlNormalization::parseAllowlist(allowlist);
+    }
+    if (const char* max_length = std::getenv(URL_MAX_LENGTH_ENV)) {
+        url_options.max_length = std::strtoul(max_length, nullptr, 10);
+    }
+    if (const char* mode = std::getenv(URL_QUERY_MODE_ENV);
+        mode && std::string(mode) == "hash") {
+        if (!key) {
+            std::cerr << URL_QUERY_MODE_ENV << "=hash needs "
+                      << PSEUDONYM_KEY_ENV << std::endl;
+            return 1;
+        }
+        // a key of its own, so query hashes cannot be matched against
+        // address pseudonyms
+        KeyedHash::Digest digest = KeyedHash(secret).hash128("url-query", 9);
+        KeyedHash::Key    url_key;
+        for (size_t i = 0; i < url_key.size(); ++i) {
+            url_key[i] = static_cast<uint8_t>(digest[i / 8] >> (8 * (i % 8)));
+        }
+        url_options.value_hash = std::make_unique<KeyedHash>(url_key);
+    }
+    auto url_normalization =
+        std::make_shared<UrlNormalization>(std::move(url_options));
+
+    const char* trace_file      = std::getenv(TRACE_FILE_ENV);
+    auto        latency_tracker = std::make_shared<LatencyTracker>(
+        trace_file ? trace_file : "");
+
+    std::unique_ptr<BufferSorter> sorter;
+    if (presort) {
+        sorter = std::make_unique<BufferSorter>();
+    }
+
+    std::shared_ptr<MetricsExporter> metrics;
+    if (const char* port = std::getenv(METRICS_PORT_ENV)) {
+        metrics = std::make_shared<MetricsExporter>(
+            static_cast<uint16_t>(std::strtoul(port, nullptr, 10)));
+    }
+    std::unique_ptr<LoadShedder> load_shedder;
+    const char*                  overload_lag = std::getenv(OVERLOAD_LAG_ENV);
+    if (overload_lag || metrics) {
+        LoadShedder::Options options;
+        if (overload_lag) {
+            options.lag_threshold =
+                std::chrono::seconds(std::strtoul(overload_lag, nullptr, 10));
+            options.recovery_lag = options.lag_threshold / 5;
+        }
+        load_shedder = std::make_unique<LoadShedder>(options, metrics);
+    }
+
+    IPAnonymizer ipAnonymizer(kafka_config, std::move(sinks),
+                              std::move(anonymization),
+                              std::move(url_normalization),
+                              std::move(latency_tracker), std::move(sorter),
+                              std::move(load_shedder));
+    if (const char* ready_file = std::getenv(READY_FILE_ENV)) {
+        ipAnonymizer.setReadyFile(ready_file);
+    }
 
     ipAnonymizer.consumeAndBufferLogs(KAFKA_TOPIC, CONSUMER_POLL_RATE_MS);
     return 0;
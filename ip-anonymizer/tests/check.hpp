@@ -0,0 +1,31 @@
+#pragma once
+
+#include <iostream>
+
+// Assertions of the unit tests, which are plain executables run by ctest. A
+// failed check prints its location and the values compared, and the test
+// carries on, so one run reports every failure; main() returns failures().
+
+namespace test {
+
+inline int& failures() {
+    static int count = 0;
+    return count;
+}
+
+template <typename Actual, typename Expected>
+void checkEqual(const Actual& actual, const Expected& expected,
+                const char* expression, const char* file, int line) {
+    if (actual == expected) return;
+    ++failures();
+    std::cerr << file << ":" << line << ": " << expression << "\n"
+              << "  actual:   " << actual << "\n"
+              << "  expected: " << expected << std::endl;
+}
+
+}  // namespace test
+
+#define CHECK_EQ(actual, expected)                                          \
+    ::test::checkEqual((actual), (expected), #actual " == " #expected,      \
+                       __FILE__, __LINE__)
+#define CHECK(condition) CHECK_EQ(static_cast<bool>(condition), true)
@@ -0,0 +1,81 @@
+// BufferSorter::TimestampOrder, the radix sort behind presorting, against
+// std::stable_sort on timestamps spread over one to four key bytes.
+
+#include <algorithm>
+#include <ctime>
+#include <memory>
+#include <numeric>
+#include <random>
+#include <vector>
+
+#include "BufferSorter.hpp"
+#include "check.hpp"
+
+namespace {
+
+std::shared_ptr<clickhouse::ColumnDateTime> columnOf(
+    const std::vector<std::time_t>& times) {
+    auto column = std::make_shared<clickhouse::ColumnDateTime>();
+    for (std::time_t time : times) column->Append(time);
+    return column;
+}
+
+std::vector<uint32_t> stableOrder(const std::vector<std::time_t>& times) {
+    std::vector<uint32_t> order(times.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::stable_sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+        return times[a] < times[b];
+    });
+    return order;
+}
+
+void testRandom() {
+    std::mt19937                 rng(42);
+    BufferSorter::TimestampOrder order;
+    const std::time_t            start = 1700000000;
+    // a minute, a day, a year and the whole DateTime range
+    for (std::time_t range : {std::time_t(60), std::time_t(86400),
+                              std::time_t(31536000), std::time_t(0xffffffff)}) {
+        for (size_t rows : {2, 3, 255, 256, 1000, 100000}) {
+            std::uniform_int_distribution<std::time_t> offset(0, range);
+            std::vector<std::time_t>                   times(rows);
+            for (auto& time : times) {
+                time = range == 0xffffffff ? offset(rng) : start + offset(rng);
+            }
+            // an unsorted start, so compute() cannot bail out
+            if (times[0] <= times[1]) std::swap(times[0], times[1]);
+            if (times[0] == times[1]) times[0] += 1;
+
+            CHECK(order.compute(*columnOf(times)));
+            CHECK(order.get() == stableOrder(times));
+        }
+    }
+}
+
+void testInOrder() {
+    BufferSorter::TimestampOrder order;
+    CHECK(!order.compute(*columnOf({})));
+    CHECK(!order.compute(*columnOf({5})));
+    CHECK(!order.compute(*columnOf({1, 1, 2, 3, 3})));
+    CHECK(order.compute(*columnOf({3, 2, 1})));
+    CHECK(order.get() == std::vector<uint32_t>({2, 1, 0}));
+}
+
+void testTies() {
+    // equal timestamps keep their Kafka order
+    BufferSorter::TimestampOrder order;
+    CHECK(order.compute(*columnOf({7, 5, 7, 5, 6, 7})));
+    CHECK(order.get() == std::vector<uint32_t>({1, 3, 4, 0, 2, 5}));
+    // a byte equal in every key is skipped, the others still sort
+    CHECK(order.compute(*columnOf({0x20100, 0x10100, 0x10000})));
+    CHECK(order.get() == std::vector<uint32_t>({2, 1, 0}));
+}
+
+}  // namespace
+
+int main() {
+    testRandom();
+    testInOrder();
+    testTies();
+    return test::failures() == 0 ? 0 : 1;
+}
@@ -0,0 +1,67 @@
+// ShardedClickHouseSink::parseTopology, shards of replicas from the
+// IP_ANONYMIZER_CLICKHOUSE_SHARDS syntax.
+
+#include <string>
+
+#include "ShardedClickHouseSink.hpp"
+#include "check.hpp"
+
+namespace {
+
+using Topology = ShardedClickHouseSink::Topology;
+
+clickhouse::ClientOptions defaults() {
+    clickhouse::ClientOptions options;
+    options.SetHost("default-host");
+    options.SetPort(9000);
+    return options;
+}
+
+void testShardsAndReplicas() {
+    Topology topology;
+    CHECK(ShardedClickHouseSink::parseTopology("a:9001,b;c:9003", defaults(),
+                                               topology));
+    CHECK_EQ(topology.size(), 2u);
+    if (topology.size() != 2) return;
+    CHECK_EQ(topology[0].size(), 2u);
+    CHECK_EQ(topology[1].size(), 1u);
+    if (topology[0].size() != 2 || topology[1].size() != 1) return;
+    CHECK_EQ(topology[0][0].host, "a");
+    CHECK_EQ(topology[0][0].port, 9001);
+    // the port defaults like every other option
+    CHECK_EQ(topology[0][1].host, "b");
+    CHECK_EQ(topology[0][1].port, 9000);
+    CHECK_EQ(topology[1][0].host, "c");
+    CHECK_EQ(topology[1][0].port, 9003);
+}
+
+void testSeparators() {
+    Topology topology;
+    // a trailing separator ends the list instead of adding an empty entry
+    CHECK(ShardedClickHouseSink::parseTopology("a,b,;c;", defaults(),
+                                               topology));
+    CHECK_EQ(topology.size(), 2u);
+    if (!topology.empty()) CHECK_EQ(topology[0].size(), 2u);
+}
+
+void testInvalid() {
+    Topology topology;
+    for (const char* spec : {"", ";", "a;;b", ":9000", "a:", "a:90x0",
+                             "a:65536", "a:-1", "a,,b"}) {
+        bool parsed =
+            ShardedClickHouseSink::parseTopology(spec, defaults(), topology);
+        CHECK_EQ(std::string(spec) + (parsed ? " accepted" : " rejected"),
+                 std::string(spec) + " rejected");
+    }
+    CHECK(ShardedClickHouseSink::parseTopology("a:65535", defaults(),
+                                               topology));
+}
+
+}  // namespace
+
+int main() {
+    testShardsAndReplicas();
+    testSeparators();
+    testInvalid();
+    return test::failures() == 0 ? 0 : 1;
+}
@@ -0,0 +1,108 @@
+// UrlNormalization: user info, fragments, the query allowlist, hashed values
+// and truncation, on urls long enough to take the 16-byte scanning path too.
+
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "UrlNormalization.hpp"
+#include "check.hpp"
+
+namespace {
+
+std::string normalize(UrlNormalization& normalization, std::string_view url) {
+    clickhouse::ColumnString column;
+    normalization.transformBatch({url}, column);
+    return std::string(column.At(0));
+}
+
+UrlNormalization allowing(std::string_view allowlist, size_t max_length = 0) {
+    UrlNormalization::Options options;
+    options.query_allowlist = UrlNormalization::parseAllowlist(allowlist);
+    options.max_length      = max_length;
+    return UrlNormalization(std::move(options));
+}
+
+void testAuthority() {
+    UrlNormalization normalization = allowing("id");
+    CHECK_EQ(normalize(normalization, "HTTPS://me:pw@Example.COM/A?id=7"),
+             "https://example.com/A?id=7");
+    CHECK_EQ(normalize(normalization, "http://Host:8080"), "http://host:8080");
+    // protocol-relative, the user info goes as well
+    CHECK_EQ(normalize(normalization, "//user:pw@Host/x?id=1"), "//host/x?id=1");
+    CHECK_EQ(normalize(normalization, "//Host"), "//host");
+    // origin-form, the path keeps its case and an '@' in it
+    CHECK_EQ(normalize(normalization, "/Users/@me?id=1"), "/Users/@me?id=1");
+    CHECK_EQ(normalize(normalization, "mailto:X@Y.com"), "mailto:X@Y.com");
+    CHECK_EQ(normalize(normalization, ""), "");
+}
+
+void testQuery() {
+    UrlNormalization normalization = allowing("id,,page");
+    CHECK_EQ(normalize(normalization, "/a?token=s3cr3t&id=7&page=2"),
+             "/a?id=7&page=2");
+    CHECK_EQ(normalize(normalization, "/a?token=s3cr3t"), "/a");
+    // empty names are neither allowed nor kept, a name without value is
+    CHECK_EQ(normalize(normalization, "/a?=x&&page&id="), "/a?page&id=");
+    CHECK_EQ(normalize(normalization, "/a?=x"), "/a");
+    // the fragment is dropped, with or without a query
+    CHECK_EQ(normalize(normalization, "/a#top"), "/a");
+    CHECK_EQ(normalize(normalization, "/a?id=1#top&page=2"), "/a?id=1");
+    CHECK_EQ(normalize(normalization,
+                       "https://example.com/a/rather/long/path/to/scan?"
+                       "session=0123456789abcdef&id=42#fragment"),
+             "https://example.com/a/rather/long/path/to/scan?id=42");
+}
+
+void testHashedValues() {
+    UrlNormalization::Options options;
+    options.query_allowlist = {"id"};
+    options.value_hash      = std::make_unique<KeyedHash>(KeyedHash::Key{});
+    UrlNormalization normalization(std::move(options));
+
+    std::string first  = normalize(normalization, "/a?id=7&token=s3cr3t&flag");
+    std::string second = normalize(normalization, "/a?token=s3cr3t");
+    std::string other  = normalize(normalization, "/a?token=other");
+    CHECK_EQ(first.substr(0, 14), "/a?id=7&token=");
+    CHECK_EQ(first.size(), std::string("/a?id=7&token=").size() + 16 + 5);
+    CHECK_EQ(first.substr(first.size() - 5), "&flag");
+    // equal values hash equally, so they can still be grouped
+    CHECK_EQ(second.substr(3), first.substr(8, 6 + 16));
+    CHECK(other != second);
+    CHECK(first.find("s3cr3t") == std::string::npos);
+}
+
+void testTruncation() {
+    UrlNormalization normalization = allowing("id", 16);
+    CHECK_EQ(normalize(normalization, "https://example.com/path?id=1"),
+             "https://example.");
+    CHECK_EQ(normalize(normalization, "/short"), "/short");
+
+    // in a batch, every url is cut on its own
+    clickhouse::ColumnString column;
+    normalization.transformBatch({"/0123456789abcdefXYZ", "/b", ""}, column);
+    CHECK_EQ(column.Size(), 3u);
+    CHECK_EQ(column.At(0), "/0123456789abcde");
+    CHECK_EQ(column.At(1), "/b");
+    CHECK_EQ(column.At(2), "");
+}
+
+void testParseAllowlist() {
+    auto names = UrlNormalization::parseAllowlist(",id,,page,");
+    CHECK_EQ(names.size(), 2u);
+    CHECK_EQ(names[0], "id");
+    CHECK_EQ(names[1], "page");
+    CHECK(UrlNormalization::parseAllowlist("").empty());
+}
+
+}  // namespace
+
+int main() {
+    testAuthority();
+    testQuery();
+    testHashedValues();
+    testTruncation();
+    testParseAllowlist();
+    return test::failures() == 0 ? 0 : 1;
+}
@@ -0,0 +1,472 @@
+// Cap'n Proto compiler plugin that turns every top-level struct of a schema
+// into a statically typed set of ClickHouse columns, an inlined appender that
+// copies a batch of decoded messages into the columns, a row
+// exporter that re-encodes a stored row and the matching CREATE TABLE
+// statement.
+//
+// Usage: capnp compile -o ./capnpc-chcolumns:<outdir> http_log.capnp
+// For "foo.capnp" the plugin writes "foo.columns.h" into <outdir>.
+
+#include <capnp/schema-loader.h>
+#include <capnp/schema.capnp.h>
+#include <capnp/schema.h>
+#include <capnp/serialize.h>
+#include <unistd.h>
+
+#include <cctype>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <set>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+// Everything the schema itself cannot express lives in the tables below. A
+// field added to the schema gets a column without touching this file; only
+// a field that needs a non-default mapping has to be listed here.
+
+// struct name -> table name and engine clause
+const std::map<std::string, std::pair<std::string, std::string>> TABLES = {
+    {"HttpLogRecord", {"http_logs", "MergeTree() ORDER BY timestamp"}},
+};
+
+// Text fields stored as LowCardinality(String)
+const std::set<std::string> LOW_CARDINALITY_FIELDS = {"cacheStatus",
+                                                      "method"};
+
+// Text fields appended through a transform object instead of directly. The
+// generated struct gets a pointer member of that type, which must provide
+//   void transformBatch(const std::vector<std::string_view>&,
+//                       clickhouse::ColumnString&)
+struct Transform {
+    std::string type;
+    std::string member;
+    std::string header;  // declares the type
+};
+const std::map<std::string, Transform> TRANSFORMED_FIELDS = {
+    {"remoteAddr",
+     {"AnonymizationStrategy", "anonymization", "Anonymization.hpp"}},
+    {"url", {"UrlNormalization", "url_normalization", "UrlNormalization.hpp"}},
+};
+
+// Columns that are not fields of the message. Their value comes from a
+// member the owner sets before appending, e.g. the weight of sampled rows,
+// and they are left out of exportRow(). The DDL type carries a DEFAULT, so
+// other writers may leave them out.
+struct ExtraColumn {
+    std::string name;
+    std::string ch_type;
+    std::string column_type;
+    std::string value_type;
+    std::string member;
+    std::string initial_value;
+};
+const std::map<std::string, std::vector<ExtraColumn>> EXTRA_COLUMNS = {
+    {"HttpLogRecord",
+     {{"sample_weight", "UInt32 DEFAULT 1", "clickhouse::ColumnUInt32",
+       "uint32_t", "next_sample_weight", "1"}}},
+};
+
+// UInt64 fields with this suffix hold milliseconds since the epoch and are
+// stored as DateTime under the name without the suffix
+const std::string EPOCH_MILLI_SUFFIX = "EpochMilli";
+
+struct ColumnSpec {
+    std::string name;         // ClickHouse column name
+    std::string ch_type;      // ClickHouse type in DDL
+    std::string column_type;  // clickhouse-cpp column class
+    std::string append_expr;  // expression over `record`
+    std::string export_stmt;  // statement filling `record` from `row`
+    std::string transform;    // member the value is appended through
+    std::string check_expr;   // a pointer field's getter, see validate()
+    bool        extra = false;  // append_expr is an EXTRA_COLUMNS member
+};
+
+std::string toSnakeCase(const std::string& camel) {
+    std::string result;
+    for (char c : camel) {
+        if (std::isupper(static_cast<unsigned char>(c))) {
+            if (!result.empty()) result += '_';
+            result += static_cast<char>(
+                std::tolower(static_cast<unsigned char>(c)));
+        } else {
+            result += c;
+        }
+    }
+    return result;
+}
+
+std::string capitalize(std::string name) {
+    if (!name.empty())
+        name[0] = static_cast<char>(
+            std::toupper(static_cast<unsigned char>(name[0])));
+    return name;
+}
+
+bool endsWith(const std::string& str, const std::string& suffix) {
+    return str.size() > suffix.size() &&
+           str.compare(str.size() - suffix.size(), suffix.size(), suffix) == 0;
+}
+
+// returns false for field types that have no flat column representation
+bool makeColumnSpec(const capnp::StructSchema::Field& field, ColumnSpec& spec) {
+    using capnp::schema::Type;
+
+    std::string field_name = field.getProto().getName().cStr();
+    std::string getter     = "record.get" + capitalize(field_name) + "()";
+    std::string setter     = "record.set" + capitalize(field_name);
+    spec.name              = toSnakeCase(field_name);
+    spec.append_expr       = getter;
+    spec.export_stmt       = setter + "(" + spec.name + "->At(row));";
+
+    switch (field.getType().which()) {
+        case Type::BOOL:
+            spec.ch_type     = "UInt8";
+            spec.column_type = "clickhouse::ColumnUInt8";
+            break;
+        case Type::INT8:
+            spec.ch_type     = "Int8";
+            spec.column_type = "clickhouse::ColumnInt8";
+            break;
+        case Type::INT16:
+            spec.ch_type     = "Int16";
+            spec.column_type = "clickhouse::ColumnInt16";
+            break;
+        case Type::INT32:
+            spec.ch_type     = "Int32";
+            spec.column_type = "clickhouse::ColumnInt32";
+            break;
+        case Type::INT64:
+            spec.ch_type     = "Int64";
+            spec.column_type = "clickhouse::ColumnInt64";
+            break;
+        case Type::UINT8:
+            spec.ch_type     = "UInt8";
+            spec.column_type = "clickhouse::ColumnUInt8";
+            break;
+        case Type::UINT16:
+            spec.ch_type     = "UInt16";
+            spec.column_type = "clickhouse::ColumnUInt16";
+            break;
+        case Type::UINT32:
+            spec.ch_type     = "UInt32";
+            spec.column_type = "clickhouse::ColumnUInt32";
+            break;
+        case Type::UINT64:
+            if (endsWith(field_name, EPOCH_MILLI_SUFFIX)) {
+                spec.name = toSnakeCase(field_name.substr(
+                    0, field_name.size() - EPOCH_MILLI_SUFFIX.size()));
+                spec.ch_type     = "DateTime";
+                spec.column_type = "clickhouse::ColumnDateTime";
+                spec.append_expr =
+                    "static_cast<std::time_t>(" + getter + " / 1000)";
+                spec.export_stmt = setter + "(static_cast<uint64_t>(" +
+                                   spec.name + "->At(row)) * 1000);";
+            } else {
+                spec.ch_type     = "UInt64";
+                spec.column_type = "clickhouse::ColumnUInt64";
+            }
+            break;
+        case Type::FLOAT32:
+            spec.ch_type     = "Float32";
+            spec.column_type = "clickhouse::ColumnFloat32";
+            break;
+        case Type::FLOAT64:
+            spec.ch_type     = "Float64";
+            spec.column_type = "clickhouse::ColumnFloat64";
+            break;
+        case Type::TEXT: {
+            spec.ch_type     = LOW_CARDINALITY_FIELDS.count(field_name)
+                                   ? "LowCardinality(String)"
+                                   : "String";
+            spec.column_type = "clickhouse::ColumnString";
+            spec.append_expr = "view(" + getter + ")";
+            spec.check_expr  = getter;
+            spec.export_stmt = "{\n            auto value = " + spec.name +
+                               "->At(row);\n            copy(value, record.init" +
+                               capitalize(field_name) +
+                               "(value.size()));\n        }";
+            auto transform   = TRANSFORMED_FIELDS.find(field_name);
+            if (transform != TRANSFORMED_FIELDS.end())
+                spec.transform = transform->second.member;
+            break;
+        }
+        default:
+            return false;
+    }
+    return true;
+}
+
+void generateStruct(std::ostream& out, const std::string& struct_name,
+                    const capnp::StructSchema& schema) {
+    std::vector<ColumnSpec> specs;
+    for (auto field : schema.getFields()) {
+        if (!field.getProto().isSlot()) continue;
+        ColumnSpec spec;
+        if (makeColumnSpec(field, spec)) {
+            specs.push_back(spec);
+        } else {
+            std::cerr << "capnpc-chcolumns: skipping " << struct_name << "."
+                      << field.getProto().getName().cStr()
+                      << ", no column mapping for its type" << std::endl;
+        }
+    }
+    if (specs.empty()) return;
+
+    auto extras = EXTRA_COLUMNS.find(struct_name);
+    if (extras != EXTRA_COLUMNS.end()) {
+        for (const auto& extra : extras->second) {
+            ColumnSpec spec;
+            spec.name        = extra.name;
+            spec.ch_type     = extra.ch_type;
+            spec.column_type = extra.column_type;
+            spec.append_expr = extra.member;
+            spec.extra       = true;
+            specs.push_back(spec);
+        }
+    }
+
+    auto table = TABLES.find(struct_name);
+    std::string table_name =
+        table != TABLES.end() ? table->second.first : toSnakeCase(struct_name);
+    std::string engine = table != TABLES.end()
+                             ? table->second.second
+                             : "MergeTree() ORDER BY tuple()";
+
+    out << "struct " << struct_name << "Columns {\n";
+    out << "    static constexpr const char* TABLE_NAME = \"" << table_name
+        << "\";\n";
+    out << "    static constexpr const char* CREATE_TABLE_DDL =\n";
+    out << "        \"CREATE TABLE IF NOT EXISTS " << table_name << " (\"\n";
+    for (size_t i = 0; i < specs.size(); ++i) {
+        out << "        \"" << specs[i].name << " " << specs[i].ch_type
+            << (i + 1 < specs.size() ? "," : "") << "\"\n";
+    }
+    out << "        \") ENGINE = " << engine << "\";\n\n";
+
+    for (const auto& spec : specs) {
+        out << "    std::shared_ptr<" << spec.column_type << "> " << spec.name
+            << " =\n        std::make_shared<" << spec.column_type
+            << ">();\n";
+    }
+
+    bool has_transforms = false;
+    for (const auto& [field, transform] : TRANSFORMED_FIELDS) {
+        for (const auto& spec : specs) {
+            if (spec.transform != transform.member) continue;
+            if (!has_transforms)
+                out << "\n    // set by the owner before the first append\n";
+            out << "    " << transform.type << "* " << transform.member
+                << " = nullptr;\n";
+            has_transforms = true;
+            break;
+        }
+    }
+    if (has_transforms) {
+        out << "    // scratch space of transformBatch() inputs\n"
+            << "    std::vector<std::string_view> transform_input;\n";
+    }
+    if (extras != EXTRA_COLUMNS.end()) {
+        out << "    // values of the columns that are not message fields, for "
+               "the rows\n    // appended next\n";
+        for (const auto& extra : extras->second) {
+            out << "    " << extra.value_type << " " << extra.member << " = "
+                << extra.initial_value << ";\n";
+        }
+    }
+
+    out << "    // rows the columns have room for at least, see grow()\n"
+        << "    size_t reserved_rows = 0;\n";
+
+    out << "\n    static inline std::string_view view(capnp::Text::Reader "
+           "text) {\n"
+        << "        return {text.cStr(), text.size()};\n"
+        << "    }\n\n";
+
+    out << "    static inline void copy(std::string_view      from,\n"
+        << "                            capnp::Text::Builder to) {\n"
+        << "        std::memcpy(to.begin(), from.data(), from.size());\n"
+        << "    }\n\n";
+
+    // a wrong-typed pointer or a text without its NUL throws in the getter,
+    // which must not happen half-way through the columns
+    out << "    // reads every pointer field like appendBatch() does, a record "
+           "that would\n"
+        << "    // throw there throws here, before any column grew\n"
+        << "    static inline void validate(const " << struct_name
+        << "::Reader& record) {\n";
+    for (const auto& spec : specs) {
+        if (spec.check_expr.empty()) continue;
+        out << "        (void)" << spec.check_expr << ";\n";
+    }
+    out << "    }\n\n";
+
+    // field-at-a-time: every column is filled by its own tight loop over the
+    // whole batch instead of touching all column tails once per row. With
+    // --profile every loop is timed on its own; the check is made once per
+    // batch and the unprofiled instantiation has no scopes at all.
+    out << "    inline void appendBatch(const std::vector<" << struct_name
+        << "::Reader>& records) {\n"
+        << "        if (StageProfiler::isEnabled())\n"
+        << "            appendColumns<true>(records);\n"
+        << "        else\n"
+        << "            appendColumns<false>(records);\n"
+        << "    }\n\n";
+    out << "    template <bool profiled>\n"
+        << "    inline void appendColumns(const std::vector<" << struct_name
+        << "::Reader>& records) {\n"
+        << "        using Scope = StageProfiler::ColumnScope<profiled>;\n"
+        << "        grow(size() + records.size());\n";
+    for (const auto& spec : specs) {
+        out << "        {\n"
+            << "            Scope scope(\"" << spec.name
+            << "\", records.size());\n";
+        if (spec.extra) {
+            out << "            for (size_t i = 0; i < records.size(); ++i)\n"
+                << "                " << spec.name << "->Append("
+                << spec.append_expr << ");\n";
+        } else if (spec.transform.empty()) {
+            out << "            for (const auto& record : records)\n"
+                << "                " << spec.name << "->Append("
+                << spec.append_expr << ");\n";
+        } else {
+            // transforms see the whole column batch at once
+            out << "            transform_input.clear();\n"
+                << "            for (const auto& record : records)\n"
+                << "                transform_input.push_back("
+                << spec.append_expr << ");\n"
+                << "            " << spec.transform
+                << "->transformBatch(transform_input, *" << spec.name
+                << ");\n";
+        }
+        out << "        }\n";
+    }
+    out << "    }\n\n";
+
+    // the inverse of appendBatch(), for re-encoding stored rows
+    out << "    inline void exportRow(size_t row, " << struct_name
+        << "::Builder record) const {\n";
+    for (const auto& spec : specs) {
+        if (spec.extra) continue;
+        out << "        " << spec.export_stmt << "\n";
+    }
+    out << "    }\n\n";
+
+    // gathers rows of another set of columns, e.g. one shard's share of a
+    // buffer, field at a time like appendBatch()
+    out << "    inline void appendRows(const " << struct_name
+        << "Columns& from,\n"
+        << "                           const std::vector<uint32_t>& rows) {\n"
+        << "        grow(size() + rows.size());\n";
+    for (const auto& spec : specs) {
+        out << "        for (uint32_t row : rows)\n"
+            << "            " << spec.name << "->Append(from." << spec.name
+            << "->At(row));\n";
+    }
+    out << "    }\n\n";
+
+    // exchanges the column data only, transform members stay
+    out << "    inline void swapColumns(" << struct_name
+        << "Columns& other) {\n";
+    for (const auto& spec : specs) {
+        out << "        " << spec.name << ".swap(other." << spec.name
+            << ");\n";
+    }
+    out << "        std::swap(reserved_rows, other.reserved_rows);\n"
+        << "    }\n\n";
+
+    out << "    inline clickhouse::Block exportToBlockShallow() const {\n"
+        << "        clickhouse::Block block;\n";
+    for (const auto& spec : specs) {
+        out << "        block.AppendColumn(\"" << spec.name << "\", "
+            << spec.name << ");\n";
+    }
+    out << "        return block;\n    }\n\n";
+
+    out << "    inline void reserve(size_t rows) {\n";
+    for (const auto& spec : specs) {
+        out << "        " << spec.name << "->Reserve(rows);\n";
+    }
+    out << "        reserved_rows = std::max(reserved_rows, rows);\n"
+        << "    }\n\n";
+
+    // reserving exactly what the next batch needs would copy the columns on
+    // every batch once they outgrow their pre-size
+    out << "    // room for rows, growing the columns at least twofold\n"
+        << "    inline void grow(size_t rows) {\n"
+        << "        if (rows > reserved_rows)\n"
+        << "            reserve(std::max(rows, 2 * reserved_rows));\n"
+        << "    }\n\n";
+
+    // a column may or may not keep its capacity, reserve() finds out
+    out << "    inline void clear() {\n";
+    for (const auto& spec : specs) {
+        out << "        " << spec.name << "->Clear();\n";
+    }
+    out << "        reserved_rows = 0;\n"
+        << "    }\n\n";
+
+    out << "    inline size_t size() const { return " << specs[0].name
+        << "->Size(); }\n";
+    out << "};\n";
+}
+
+}  // namespace
+
+int main() {
+    capnp::ReaderOptions options;
+    options.traversalLimitInWords = 1 << 30;
+    capnp::StreamFdMessageReader message(STDIN_FILENO, options);
+    auto request = message.getRoot<capnp::schema::CodeGeneratorRequest>();
+
+    capnp::SchemaLoader loader;
+    for (auto node : request.getNodes()) loader.load(node);
+
+    for (auto file : request.getRequestedFiles()) {
+        std::string source = file.getFilename().cStr();
+        std::string output = source;
+        if (endsWith(output, ".capnp"))
+            output.resize(output.size() - std::string(".capnp").size());
+        output += ".columns.h";
+
+        std::ostringstream body;
+        auto               file_schema = loader.get(file.getId());
+        for (auto nested : file_schema.getProto().getNestedNodes()) {
+            auto schema = loader.get(nested.getId());
+            if (!schema.getProto().isStruct()) continue;
+            generateStruct(body, nested.getName().cStr(), schema.asStruct());
+        }
+
+        std::ofstream out(output);
+        if (!out) {
+            std::cerr << "capnpc-chcolumns: cannot write " << output
+                      << std::endl;
+            return 1;
+        }
+        out << "// Generated by capnpc-chcolumns, DO NOT EDIT\n"
+            << "// source: " << source << "\n\n"
+            << "#pragma once\n\n"
+            << "#include <clickhouse/client.h>\n\n"
+            << "#include <algorithm>\n"
+            << "#include <cstdint>\n"
+            << "#include <cstring>\n"
+            << "#include <ctime>\n"
+            << "#include <memory>\n"
+            << "#include <string_view>\n"
+            << "#include <utility>\n"
+            << "#include <vector>\n\n";
+        // appendBatch() times its columns with the profiler
+        std::set<std::string> headers = {"StageProfiler.hpp"};
+        for (const auto& [field, transform] : TRANSFORMED_FIELDS) {
+            headers.insert(transform.header);
+        }
+        for (const auto& header : headers) {
+            out << "#include \"" << header << "\"\n";
+        }
+        out << "#include \"" << source << ".h\"\n\n" << body.str();
+    }
+    return 0;
+}